@@ -0,0 +1,106 @@
+/*
+  ==============================================================================
+
+    SimpleSampler - WAV Sampler Plugin with Virtual Keyboard
+    BatchMain.cpp - Command-line batch renderer
+
+    Usage: SimpleSamplerBatch <jobs.json> [--threads N] [--block-size N]
+
+    Jobs run in parallel, each on its own processor instance. The block
+    size is the same for every job whatever the thread count, so the output
+    is bit-identical to rendering with --threads 1.
+
+  ==============================================================================
+*/
+
+#include "BatchRenderer.h"
+#include "SampleLibrary.h"
+
+#include <iostream>
+
+int main (int argc, char* argv[])
+{
+    // Processors start timers, so a message manager has to exist even though nothing dispatches it
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    const juce::ArgumentList arguments (argc, argv);
+
+    if (arguments.size() == 0 || arguments[0].isOption())
+    {
+        std::cerr << "Usage: " << arguments.executableName << " <jobs.json> [--threads N] [--block-size N]" << std::endl;
+        return 1;
+    }
+
+    const auto jobListFile = arguments[0].resolveAsFile();
+
+    const auto numThreads = arguments.containsOption ("--threads")
+                                ? juce::jmax (1, arguments.getValueForOption ("--threads").getIntValue())
+                                : juce::SystemStats::getNumCpus();
+
+    const auto blockSize = arguments.containsOption ("--block-size")
+                               ? juce::jlimit (32, 65536, arguments.getValueForOption ("--block-size").getIntValue())
+                               : 4096;
+
+    juce::Array<BatchRenderer::Job> jobs;
+    const auto readResult = BatchRenderer::readJobList (jobListFile, jobs);
+
+    if (readResult.failed())
+    {
+        std::cerr << jobListFile.getFullPathName() << ": " << readResult.getErrorMessage() << std::endl;
+        return 1;
+    }
+
+    // Every job's processor shares the library, so samples used by several jobs are decoded
+    // once; holding it here keeps it alive between jobs that would otherwise each rebuild it
+    juce::SharedResourcePointer<SampleLibrary> sampleLibrary;
+
+    //==============================================================================
+    std::vector<BatchRenderer::JobResult> results ((size_t) jobs.size());
+    const auto startTime = juce::Time::getMillisecondCounterHiRes();
+
+    juce::ThreadPool pool (numThreads);
+    juce::WaitableEvent allJobsFinished;
+    std::atomic<int> numJobsLeft { jobs.size() };
+
+    for (int i = 0; i < jobs.size(); ++i)
+        pool.addJob ([&jobs, &results, &numJobsLeft, &allJobsFinished, i, blockSize]
+                     {
+                         results[(size_t) i] = BatchRenderer::renderJob (jobs.getReference (i), blockSize);
+
+                         if (--numJobsLeft == 0)
+                             allJobsFinished.signal();
+                     });
+
+    // The pool's destructor would drop jobs that haven't started, so wait for all of them here
+    if (jobs.size() > 0)
+        allJobsFinished.wait (-1);
+
+    //==============================================================================
+    const auto wallSeconds = (juce::Time::getMillisecondCounterHiRes() - startTime) / 1000.0;
+    double renderedSeconds = 0.0;
+    int numFailed = 0;
+
+    for (int i = 0; i < jobs.size(); ++i)
+    {
+        const auto& result = results[(size_t) i];
+        const auto outputPath = jobs.getReference (i).output.getFullPathName();
+
+        if (result.result.failed())
+        {
+            std::cerr << "FAILED " << outputPath << ": " << result.result.getErrorMessage() << std::endl;
+            ++numFailed;
+            continue;
+        }
+
+        renderedSeconds += result.renderedSeconds;
+        std::cout << outputPath << "  " << juce::String (result.renderedSeconds, 1) << " s in "
+                  << juce::String (result.wallSeconds, 2) << " s" << std::endl;
+    }
+
+    std::cout << jobs.size() - numFailed << " of " << jobs.size() << " jobs rendered on " << numThreads
+              << " threads: " << juce::String (renderedSeconds, 1) << " s of audio in "
+              << juce::String (wallSeconds, 2) << " s ("
+              << juce::String (renderedSeconds / juce::jmax (wallSeconds, 0.001), 1) << "x realtime)" << std::endl;
+
+    return numFailed == 0 ? 0 : 1;
+}
@@ -0,0 +1,201 @@
+/*
+  ==============================================================================
+
+    SimpleSampler - WAV Sampler Plugin with Virtual Keyboard
+    BatchRenderer.cpp - Offline rendering of MIDI files through the sampler
+
+  ==============================================================================
+*/
+
+#include "BatchRenderer.h"
+#include "PluginProcessor.h"
+
+namespace BatchRenderer
+{
+    //==============================================================================
+    static juce::Result readJob (const juce::var& json, const juce::File& baseDirectory, Job& job)
+    {
+        auto getFile = [&] (const char* name) { return baseDirectory.getChildFile (json[name].toString()); };
+
+        if ((json["sample"].toString().isEmpty() && json["kit"].toString().isEmpty())
+             || json["midi"].toString().isEmpty() || json["output"].toString().isEmpty())
+            return juce::Result::fail ("Each job needs \"sample\" or \"kit\", \"midi\" and \"output\"");
+
+        if (json["kit"].toString().isNotEmpty())
+            job.kit = getFile ("kit");
+        else
+            job.sample = getFile ("sample");
+
+        job.midi = getFile ("midi");
+        job.output = getFile ("output");
+
+        if (json.hasProperty ("sampleRate"))
+            job.sampleRate = (double) json["sampleRate"];
+
+        if (json.hasProperty ("tailSeconds"))
+            job.tailSeconds = (double) json["tailSeconds"];
+
+        if (json.hasProperty ("bitDepth"))
+            job.bitDepth = (int) json["bitDepth"];
+
+        if (job.sampleRate <= 0.0 || job.tailSeconds < 0.0)
+            return juce::Result::fail ("Invalid sample rate or tail length for " + job.output.getFileName());
+
+        if (auto* parameters = json["parameters"].getDynamicObject())
+            job.parameters = parameters->getProperties();
+
+        return juce::Result::ok();
+    }
+
+    juce::Result readJobList (const juce::File& jobListFile, juce::Array<Job>& jobs)
+    {
+        juce::var json;
+        const auto parseResult = juce::JSON::parse (jobListFile.loadFileAsString(), json);
+
+        if (parseResult.failed())
+            return parseResult;
+
+        const auto& jobArray = json.isArray() ? json : json["jobs"];
+
+        if (! jobArray.isArray())
+            return juce::Result::fail ("Expected an array of jobs");
+
+        for (const auto& jobJson : *jobArray.getArray())
+        {
+            Job job;
+            const auto result = readJob (jobJson, jobListFile.getParentDirectory(), job);
+
+            if (result.failed())
+                return result;
+
+            jobs.add (job);
+        }
+
+        return juce::Result::ok();
+    }
+
+    //==============================================================================
+    static juce::Result readMidi (const juce::File& file, juce::MidiMessageSequence& sequence)
+    {
+        juce::FileInputStream stream (file);
+        juce::MidiFile midiFile;
+
+        if (! stream.openedOk() || ! midiFile.readFrom (stream))
+            return juce::Result::fail ("Could not read MIDI file " + file.getFullPathName());
+
+        midiFile.convertTimestampTicksToSeconds();
+
+        for (int track = 0; track < midiFile.getNumTracks(); ++track)
+            sequence.addSequence (*midiFile.getTrack (track), 0.0);
+
+        return juce::Result::ok();
+    }
+
+    static juce::Result applyParameters (SimpleSamplerAudioProcessor& processor, const juce::NamedValueSet& parameters)
+    {
+        auto& state = processor.getValueTreeState();
+
+        for (const auto& property : parameters)
+        {
+            auto* parameter = state.getParameter (property.name.toString());
+
+            if (parameter == nullptr)
+                return juce::Result::fail ("Unknown parameter \"" + property.name.toString() + "\"");
+
+            parameter->setValueNotifyingHost (parameter->convertTo0to1 ((float) property.value));
+        }
+
+        return juce::Result::ok();
+    }
+
+    JobResult renderJob (const Job& job, int blockSize)
+    {
+        JobResult jobResult;
+        const auto startTime = juce::Time::getMillisecondCounterHiRes();
+
+        SimpleSamplerAudioProcessor processor;
+        processor.setNonRealtime (true);
+
+        jobResult.result = applyParameters (processor, job.parameters);
+
+        if (jobResult.result.failed())
+            return jobResult;
+
+        // Decoded once per file and shared by every job using it
+        if (job.kit != juce::File())
+        {
+            jobResult.result = processor.loadKitFile (job.kit);
+
+            if (jobResult.result.failed())
+                return jobResult;
+        }
+        else if (! processor.loadSample (job.sample))
+        {
+            jobResult.result = juce::Result::fail ("Could not load sample " + job.sample.getFullPathName());
+            return jobResult;
+        }
+
+        juce::MidiMessageSequence sequence;
+        jobResult.result = readMidi (job.midi, sequence);
+
+        if (jobResult.result.failed())
+            return jobResult;
+
+        const auto numChannels = processor.getTotalNumOutputChannels();
+
+        job.output.getParentDirectory().createDirectory();
+        job.output.deleteFile();
+
+        std::unique_ptr<juce::OutputStream> outputStream (job.output.createOutputStream());
+        std::unique_ptr<juce::AudioFormatWriter> writer;
+
+        if (outputStream != nullptr)
+            writer.reset (juce::WavAudioFormat().createWriterFor (outputStream.get(), job.sampleRate,
+                                                                  (unsigned int) numChannels, job.bitDepth, {}, 0));
+
+        if (writer == nullptr)
+        {
+            jobResult.result = juce::Result::fail ("Could not write " + job.output.getFullPathName());
+            return jobResult;
+        }
+
+        outputStream.release();     // Now owned by the writer
+
+        processor.setRateAndBufferSizeDetails (job.sampleRate, blockSize);
+        processor.prepareToPlay (job.sampleRate, blockSize);
+
+        const auto totalSamples = (juce::int64) std::ceil ((sequence.getEndTime() + job.tailSeconds) * job.sampleRate);
+
+        juce::AudioBuffer<float> buffer (numChannels, blockSize);
+        juce::MidiBuffer midi;
+        int nextEvent = 0;
+
+        for (juce::int64 blockStart = 0; blockStart < totalSamples; blockStart += blockSize)
+        {
+            const auto numSamples = (int) juce::jmin ((juce::int64) blockSize, totalSamples - blockStart);
+            buffer.setSize (numChannels, numSamples, false, false, true);
+            midi.clear();
+
+            for (; nextEvent < sequence.getNumEvents(); ++nextEvent)
+            {
+                const auto& message = sequence.getEventPointer (nextEvent)->message;
+                const auto samplePosition = (juce::int64) std::llround (message.getTimeStamp() * job.sampleRate);
+
+                if (samplePosition >= blockStart + numSamples)
+                    break;
+
+                if (! message.isMetaEvent())
+                    midi.addEvent (message, (int) (samplePosition - blockStart));
+            }
+
+            processor.processBlock (buffer, midi);
+            writer->writeFromAudioSampleBuffer (buffer, 0, numSamples);
+        }
+
+        processor.releaseResources();
+
+        jobResult.renderedSeconds = (double) totalSamples / job.sampleRate;
+        jobResult.wallSeconds = (juce::Time::getMillisecondCounterHiRes() - startTime) / 1000.0;
+        return jobResult;
+    }
+}
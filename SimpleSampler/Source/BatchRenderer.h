@@ -0,0 +1,54 @@
+/*
+  ==============================================================================
+
+    SimpleSampler - WAV Sampler Plugin with Virtual Keyboard
+    BatchRenderer.h - Offline rendering of MIDI files through the sampler
+
+    Each job gets its own SimpleSamplerAudioProcessor and nothing else is
+    shared between jobs except decoded sample data, which is read-only. A
+    job's output therefore depends only on the job and the block size, not
+    on how many jobs run alongside it.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+namespace BatchRenderer
+{
+    /** One MIDI file to render through one sample or a kit file. */
+    struct Job
+    {
+        juce::File sample;                  // Played across the whole keyboard, unless a kit is given
+        juce::File kit;                     // A kit file, as loaded by the editor's Load Kit button
+        juce::File midi;
+        juce::File output;                  // Written as WAV
+        double sampleRate = 48000.0;
+        double tailSeconds = 2.0;           // Rendered after the last MIDI event
+        int bitDepth = 24;
+        juce::NamedValueSet parameters;     // Parameter ID to value, in the parameter's own units
+    };
+
+    struct JobResult
+    {
+        juce::Result result = juce::Result::ok();
+        double renderedSeconds = 0.0;
+        double wallSeconds = 0.0;
+    };
+
+    /** Reads a JSON job list, either an array of jobs or an object with a "jobs" array:
+
+            { "jobs": [ { "sample": "piano.wav", "midi": "stem.mid", "output": "out/stem.wav",
+                          "sampleRate": 48000, "tailSeconds": 2, "bitDepth": 24,
+                          "parameters": { "attack": 0.005, "release": 0.4 } } ] }
+
+        A job may give "kit" instead of "sample", naming a kit file; a bank of kits in it
+        fills programs from 0 upwards for the MIDI file's program changes. Relative paths
+        are resolved against the job list's folder. */
+    juce::Result readJobList (const juce::File& jobListFile, juce::Array<Job>& jobs);
+
+    /** Renders one job on the calling thread in blocks of blockSize samples. */
+    JobResult renderJob (const Job& job, int blockSize);
+}
@@ -0,0 +1,293 @@
+/*
+  ==============================================================================
+
+    SimpleSampler - WAV Sampler Plugin with Virtual Keyboard
+    EnvelopeGenerator.h - Block-based ADSR envelope
+
+    The envelope runs at the host sample rate and renders whole segments
+    into a buffer. Each segment is a one-pole exponential approach towards
+    an overshoot target, so the number of samples left in a segment can be
+    computed in closed form and the inner loop runs without branches.
+
+    Segments and the running value are kept in double: near-linear curves
+    over long times have a per-sample coefficient within a few ulps of 1,
+    which single precision would round to exactly 1 and so end the segment
+    at once.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+ * ADSR envelope that renders blocks of gain values
+ */
+class EnvelopeGenerator
+{
+public:
+    struct Parameters
+    {
+        float attack  = 0.01f;  // seconds
+        float decay   = 0.1f;   // seconds
+        float sustain = 1.0f;   // level 0-1
+        float release = 0.1f;   // seconds
+        float curve   = 0.5f;   // 0 = linear, 1 = strongly exponential
+
+        bool operator== (const Parameters& other) const noexcept
+        {
+            return attack == other.attack && decay == other.decay && sustain == other.sustain
+                && release == other.release && curve == other.curve;
+        }
+
+        bool operator!= (const Parameters& other) const noexcept { return ! operator== (other); }
+    };
+
+    EnvelopeGenerator() { recalculateSegments(); }
+
+    //==============================================================================
+    void setSampleRate (double newSampleRate) noexcept
+    {
+        jassert (newSampleRate > 0.0);
+
+        if (sampleRate != newSampleRate)
+        {
+            sampleRate = newSampleRate;
+            recalculateSegments();
+        }
+    }
+
+    void setParameters (const Parameters& newParameters) noexcept
+    {
+        if (parameters != newParameters)
+        {
+            parameters = newParameters;
+            recalculateSegments();
+        }
+    }
+
+    const Parameters& getParameters() const noexcept { return parameters; }
+
+    //==============================================================================
+    void noteOn() noexcept
+    {
+        state = State::attack;
+    }
+
+    void noteOff() noexcept
+    {
+        // A fade already ends sooner than any release
+        if (state != State::idle && state != State::fade)
+            state = value > 0.0 ? State::release : State::idle;
+    }
+
+    /** Ramps linearly to silence over the given time, ignoring the release setting. */
+    void fadeOut (float timeSeconds) noexcept
+    {
+        if (state == State::idle)
+            return;
+
+        fadeSamplesRemaining = juce::jmax (1, juce::roundToInt (timeSeconds * sampleRate));
+        fadeStep = -value / (double) fadeSamplesRemaining;
+        state = State::fade;
+    }
+
+    void reset() noexcept
+    {
+        state = State::idle;
+        value = 0.0;
+    }
+
+    bool isActive() const noexcept    { return state != State::idle; }
+    bool isReleasing() const noexcept { return state == State::release || state == State::fade; }
+
+    //==============================================================================
+    /** Writes the next numSamples envelope values into dest. */
+    void render (float* dest, int numSamples) noexcept
+    {
+        while (numSamples > 0)
+        {
+            if (state == State::idle)
+            {
+                juce::FloatVectorOperations::clear (dest, numSamples);
+                return;
+            }
+
+            if (state == State::sustain)
+            {
+                value = (double) parameters.sustain;
+                juce::FloatVectorOperations::fill (dest, parameters.sustain, numSamples);
+                return;
+            }
+
+            if (state == State::fade)
+            {
+                const auto num = juce::jmin (numSamples, fadeSamplesRemaining);
+                auto v = value;
+
+                for (int i = 0; i < num; ++i)
+                    dest[i] = (float) (v += fadeStep);
+
+                value = v;
+                fadeSamplesRemaining -= num;
+                dest += num;
+                numSamples -= num;
+
+                if (fadeSamplesRemaining == 0)
+                {
+                    dest[-1] = 0.0f;
+                    reset();
+                }
+
+                continue;
+            }
+
+            const auto& segment = getSegment();
+            const auto endValue = getSegmentEndValue();
+            const auto remaining = samplesUntil (segment, endValue);
+
+            if (remaining == 0)
+            {
+                value = endValue;
+                advanceState();
+                continue;
+            }
+
+            const auto num = juce::jmin (numSamples, remaining);
+            const auto coef = segment.coefficient;
+            const auto base = segment.base;
+            auto v = value;
+
+            for (int i = 0; i < num; ++i)
+                dest[i] = (float) (v = v * coef + base);
+
+            value = v;
+            dest += num;
+            numSamples -= num;
+
+            if (num == remaining)
+            {
+                value = endValue;
+                dest[-1] = (float) endValue;
+                advanceState();
+            }
+        }
+    }
+
+private:
+    //==============================================================================
+    enum class State { idle, attack, decay, sustain, release, fade };
+
+    /** v[n + 1] = v[n] * coefficient + base, which approaches base / (1 - coefficient). */
+    struct Segment
+    {
+        double coefficient = 0.0;
+        double base = 0.0;
+        double asymptote = 0.0;
+    };
+
+    const Segment& getSegment() const noexcept
+    {
+        switch (state)
+        {
+            case State::attack: return attackSegment;
+            case State::decay:  return decaySegment;
+            default:            return releaseSegment;
+        }
+    }
+
+    double getSegmentEndValue() const noexcept
+    {
+        switch (state)
+        {
+            case State::attack: return 1.0;
+            case State::decay:  return (double) parameters.sustain;
+            default:            return 0.0;
+        }
+    }
+
+    void advanceState() noexcept
+    {
+        switch (state)
+        {
+            case State::attack:  state = State::decay; break;
+            case State::decay:   state = State::sustain; break;
+            case State::release: reset(); break;
+            default:             break;
+        }
+    }
+
+    /** Number of samples until the segment crosses endValue, from the closed form
+        v[n] = asymptote + (v[0] - asymptote) * coefficient^n. */
+    int samplesUntil (const Segment& segment, double endValue) const noexcept
+    {
+        const auto distanceNow = value - segment.asymptote;
+        const auto distanceAtEnd = endValue - segment.asymptote;
+
+        if (distanceNow == 0.0 || distanceAtEnd / distanceNow >= 1.0)
+            return 0;
+
+        if (segment.coefficient <= 0.0)
+            return 1;
+
+        const auto ratio = distanceAtEnd / distanceNow;
+
+        if (ratio <= 0.0)
+            return std::numeric_limits<int>::max();
+
+        const auto n = std::ceil (std::log (ratio) / std::log (segment.coefficient));
+        return (int) juce::jlimit (1.0, (double) std::numeric_limits<int>::max() / 2.0, n);
+    }
+
+    /** Maps the curve parameter to the overshoot of the exponential target: a large
+        overshoot gives a near-linear ramp, a small one a strongly curved ramp. */
+    double getTargetRatio() const noexcept
+    {
+        return 0.001 * std::pow (100000.0, 1.0 - (double) juce::jlimit (0.0f, 1.0f, parameters.curve));
+    }
+
+    Segment makeSegment (float timeSeconds, double target) const noexcept
+    {
+        Segment segment;
+        segment.asymptote = target;
+
+        const auto numSamples = (double) timeSeconds * sampleRate;
+        auto oneMinusCoefficient = 1.0;
+
+        if (numSamples >= 1.0)
+        {
+            // log1p and expm1 stay accurate when the coefficient is very close to 1
+            const auto step = std::log1p (1.0 / getTargetRatio()) / numSamples;
+            segment.coefficient = std::exp (-step);
+            oneMinusCoefficient = -std::expm1 (-step);
+        }
+
+        segment.base = target * oneMinusCoefficient;
+        return segment;
+    }
+
+    void recalculateSegments() noexcept
+    {
+        const auto ratio = getTargetRatio();
+
+        attackSegment  = makeSegment (parameters.attack,  1.0 + ratio);
+        decaySegment   = makeSegment (parameters.decay,   (double) parameters.sustain - ratio);
+        releaseSegment = makeSegment (parameters.release, -ratio);
+    }
+
+    //==============================================================================
+    double sampleRate = 44100.0;
+    Parameters parameters;
+
+    Segment attackSegment, decaySegment, releaseSegment;
+
+    State state = State::idle;
+    double value = 0.0;
+
+    int fadeSamplesRemaining = 0;
+    double fadeStep = 0.0;
+
+    JUCE_LEAK_DETECTOR (EnvelopeGenerator)
+};
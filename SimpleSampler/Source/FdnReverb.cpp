@@ -0,0 +1,317 @@
+/*
+  ==============================================================================
+
+    SimpleSampler - WAV Sampler Plugin with Virtual Keyboard
+    FdnReverb.cpp - Stereo feedback delay network reverb
+
+  ==============================================================================
+*/
+
+#include "FdnReverb.h"
+
+namespace
+{
+    // Mutually prime-ish lengths so the lines' echoes don't pile up on each other
+    constexpr std::array<double, FdnReverb::numLines> lineLengthsMs { 31.1, 37.3, 41.9, 47.9, 53.3, 59.9, 67.1, 73.9 };
+
+    // Input sign per line, so the left and right inputs don't start out correlated
+    constexpr std::array<float, FdnReverb::numLines> inputSigns { 1.0f, -1.0f, 1.0f, -1.0f, 1.0f, -1.0f, 1.0f, -1.0f };
+
+    constexpr int maxChunkLength = 256;
+    constexpr float inputGain = 0.25f;
+
+    // Parameter ramps and pre-delay crossfades
+    constexpr double rampSeconds = 0.05;
+}
+
+//==============================================================================
+void FdnReverb::prepare (double newSampleRate, int /*maximumBlockSize*/)
+{
+    sampleRate = newSampleRate;
+
+    for (size_t i = 0; i < (size_t) numLines; ++i)
+        lineLengths[i] = juce::jmax (1, juce::roundToInt (lineLengthsMs[i] * sampleRate / 1000.0)) | 1;
+
+    // A chunk never reads anything it writes itself
+    maxChunkSize = juce::jmin (maxChunkLength, lineLengths[0]);
+    lineRingSize = lineLengths[numLines - 1] + maxChunkSize;
+
+    for (auto& line : lines)
+        line.assign ((size_t) lineRingSize, 0.0f);
+
+    preDelaySize = juce::roundToInt (maxPreDelayMs * sampleRate / 1000.0) + maxChunkSize;
+
+    for (auto& channel : preDelay)
+        channel.assign ((size_t) preDelaySize, 0.0f);
+
+    scratch.setSize (numScratchRows, maxChunkSize);
+
+    for (auto& gain : feedbackGains)
+        gain.reset (sampleRate, rampSeconds);
+
+    for (auto* value : { &dampingCoefficient, &wetLevel, &dryLevel, &width, &preDelayFade })
+        value->reset (sampleRate, rampSeconds);
+
+    updateCoefficients();
+    reset();
+    prepared = true;
+}
+
+void FdnReverb::reset() noexcept
+{
+    for (auto& line : lines)
+        std::fill (line.begin(), line.end(), 0.0f);
+
+    for (auto& channel : preDelay)
+        std::fill (channel.begin(), channel.end(), 0.0f);
+
+    dampingStates.fill (0.0f);
+    lineWritePosition = 0;
+    preDelayWritePosition = 0;
+
+    skipRamps();
+}
+
+void FdnReverb::skipRamps() noexcept
+{
+    for (auto& gain : feedbackGains)
+        gain.setCurrentAndTargetValue (gain.getTargetValue());
+
+    for (auto* value : { &dampingCoefficient, &wetLevel, &dryLevel, &width })
+        value->setCurrentAndTargetValue (value->getTargetValue());
+
+    preDelayFade.setCurrentAndTargetValue (1.0f);
+    previousPreDelaySamples = preDelaySamples;
+}
+
+void FdnReverb::setParameters (const Parameters& newParameters) noexcept
+{
+    const auto needsUpdate = newParameters.roomSize != parameters.roomSize
+                          || newParameters.damping != parameters.damping
+                          || newParameters.preDelayMs != parameters.preDelayMs;
+
+    parameters = newParameters;
+
+    wetLevel.setTargetValue (parameters.wetLevel);
+    dryLevel.setTargetValue (parameters.dryLevel);
+    width.setTargetValue (juce::jlimit (0.0f, 1.0f, parameters.width));
+
+    if (needsUpdate)
+        updateCoefficients();
+}
+
+void FdnReverb::updateCoefficients() noexcept
+{
+    const auto t60 = getDecayTime (parameters.roomSize);
+
+    // Each pass through a line loses its share of 60 dB over t60. The Hadamard matrix is
+    // scaled by 1 / sqrt (numLines) to stay lossless, and that is folded in here.
+    for (size_t i = 0; i < (size_t) numLines; ++i)
+        feedbackGains[i].setTargetValue ((float) (std::pow (10.0, -3.0 * lineLengths[i] / (t60 * sampleRate)) / std::sqrt ((double) numLines)));
+
+    dampingCoefficient.setTargetValue (0.85f * juce::jlimit (0.0f, 1.0f, parameters.damping));
+
+    const auto newPreDelaySamples = juce::jlimit (0, preDelaySize - maxChunkSize,
+                                                  juce::roundToInt (parameters.preDelayMs * sampleRate / 1000.0));
+
+    if (newPreDelaySamples != preDelaySamples)
+    {
+        // A change during a fade starts the next one from whichever delay is louder now
+        if (preDelayFade.getCurrentValue() >= 0.5f)
+            previousPreDelaySamples = preDelaySamples;
+
+        preDelaySamples = newPreDelaySamples;
+        preDelayFade.setCurrentAndTargetValue (0.0f);
+        preDelayFade.setTargetValue (1.0f);
+    }
+}
+
+//==============================================================================
+void FdnReverb::process (juce::AudioBuffer<float>& buffer) noexcept
+{
+    if (! prepared || buffer.getNumChannels() == 0)
+        return;
+
+    auto* left = buffer.getWritePointer (0);
+    auto* right = buffer.getNumChannels() > 1 ? buffer.getWritePointer (1) : nullptr;
+
+    for (int start = 0; start < buffer.getNumSamples(); start += maxChunkSize)
+    {
+        const auto numSamples = juce::jmin (maxChunkSize, buffer.getNumSamples() - start);
+        processChunk (left + start, right != nullptr ? right + start : nullptr, numSamples);
+    }
+}
+
+void FdnReverb::processChunk (float* left, float* right, int numSamples) noexcept
+{
+    auto row = [this] (int index) { return scratch.getWritePointer (index); };
+
+    auto* inputLeft = row (inputLeftRow);
+    auto* inputRight = row (inputRightRow);
+    auto* wetLeft = row (wetLeftRow);
+    auto* wetRight = row (wetRightRow);
+
+    // Pre-delay; written first so a zero delay reads back this chunk's input
+    writeToRing (preDelay[0].data(), preDelaySize, preDelayWritePosition, left, numSamples);
+    writeToRing (preDelay[1].data(), preDelaySize, preDelayWritePosition, right != nullptr ? right : left, numSamples);
+
+    auto readPreDelay = [this, numSamples] (int delay, float* destLeft, float* destRight)
+    {
+        const auto readPosition = (preDelayWritePosition - delay + preDelaySize) % preDelaySize;
+        readFromRing (preDelay[0].data(), preDelaySize, readPosition, destLeft, numSamples);
+        readFromRing (preDelay[1].data(), preDelaySize, readPosition, destRight, numSamples);
+    };
+
+    readPreDelay (preDelaySamples, inputLeft, inputRight);
+
+    if (preDelayFade.isSmoothing())
+    {
+        // The wet rows aren't filled until the lines are read, so they hold the old delay's input meanwhile
+        readPreDelay (previousPreDelaySamples, wetLeft, wetRight);
+
+        for (int n = 0; n < numSamples; ++n)
+        {
+            const auto fade = preDelayFade.getNextValue();
+            inputLeft[n] = wetLeft[n] + fade * (inputLeft[n] - wetLeft[n]);
+            inputRight[n] = wetRight[n] + fade * (inputRight[n] - wetRight[n]);
+        }
+    }
+
+    preDelayWritePosition = (preDelayWritePosition + numSamples) % preDelaySize;
+
+    // Line outputs through their damping filters
+    auto* damping = row (dampingRow);
+    fillRamp (dampingCoefficient, damping, numSamples);
+
+    for (int i = 0; i < numLines; ++i)
+    {
+        auto* line = row (i);
+        const auto readPosition = (lineWritePosition - lineLengths[(size_t) i] + lineRingSize) % lineRingSize;
+        readFromRing (lines[(size_t) i].data(), lineRingSize, readPosition, line, numSamples);
+
+        auto state = dampingStates[(size_t) i];
+
+        for (int n = 0; n < numSamples; ++n)
+        {
+            state = line[n] + damping[n] * (state - line[n]);
+            line[n] = state;
+        }
+
+        dampingStates[(size_t) i] = state;
+    }
+
+    // Even lines to the left, odd lines to the right
+    juce::FloatVectorOperations::add (wetLeft, row (0), row (2), numSamples);
+    juce::FloatVectorOperations::add (wetLeft, row (4), numSamples);
+    juce::FloatVectorOperations::add (wetLeft, row (6), numSamples);
+    juce::FloatVectorOperations::add (wetRight, row (1), row (3), numSamples);
+    juce::FloatVectorOperations::add (wetRight, row (5), numSamples);
+    juce::FloatVectorOperations::add (wetRight, row (7), numSamples);
+
+    // Feedback: decay, mix, add the input and write back
+    for (int i = 0; i < numLines; ++i)
+        feedbackGains[(size_t) i].applyGain (row (i), numSamples);
+
+    mixLines (numSamples);
+
+    for (int i = 0; i < numLines; ++i)
+    {
+        juce::FloatVectorOperations::addWithMultiply (row (i), i < numLines / 2 ? inputLeft : inputRight,
+                                                      inputGain * inputSigns[(size_t) i], numSamples);
+        writeToRing (lines[(size_t) i].data(), lineRingSize, lineWritePosition, row (i), numSamples);
+    }
+
+    lineWritePosition = (lineWritePosition + numSamples) % lineRingSize;
+
+    // Width crossfades each side towards the mid signal, then mix with the dry signal
+    auto* dry = row (dryRow);
+    auto* same = row (sameRow);
+    auto* opposite = row (oppositeRow);
+
+    fillRamp (dryLevel, dry, numSamples);
+
+    if (wetLevel.isSmoothing() || width.isSmoothing())
+    {
+        for (int n = 0; n < numSamples; ++n)
+        {
+            const auto wet = wetLevel.getNextValue() * 0.5f;
+            const auto sideWidth = width.getNextValue();
+            same[n] = wet * (1.0f + sideWidth) * 0.5f;
+            opposite[n] = wet * (1.0f - sideWidth) * 0.5f;
+        }
+    }
+    else
+    {
+        const auto wet = wetLevel.getCurrentValue() * 0.5f;
+        juce::FloatVectorOperations::fill (same, wet * (1.0f + width.getCurrentValue()) * 0.5f, numSamples);
+        juce::FloatVectorOperations::fill (opposite, wet * (1.0f - width.getCurrentValue()) * 0.5f, numSamples);
+    }
+
+    juce::FloatVectorOperations::multiply (left, dry, numSamples);
+
+    if (right != nullptr)
+    {
+        juce::FloatVectorOperations::multiply (right, dry, numSamples);
+        juce::FloatVectorOperations::addWithMultiply (left, wetLeft, same, numSamples);
+        juce::FloatVectorOperations::addWithMultiply (left, wetRight, opposite, numSamples);
+        juce::FloatVectorOperations::addWithMultiply (right, wetRight, same, numSamples);
+        juce::FloatVectorOperations::addWithMultiply (right, wetLeft, opposite, numSamples);
+    }
+    else
+    {
+        // Same plus opposite is the whole wet level; both wet sides get half of it
+        juce::FloatVectorOperations::add (same, opposite, numSamples);
+        juce::FloatVectorOperations::multiply (same, 0.5f, numSamples);
+        juce::FloatVectorOperations::addWithMultiply (left, wetLeft, same, numSamples);
+        juce::FloatVectorOperations::addWithMultiply (left, wetRight, same, numSamples);
+    }
+}
+
+void FdnReverb::mixLines (int numSamples) noexcept
+{
+    // Fast Walsh-Hadamard transform across the line rows: log2 (numLines) butterfly stages
+    auto* temp = scratch.getWritePointer (tempRow);
+
+    for (int half = 1; half < numLines; half *= 2)
+    {
+        for (int first = 0; first < numLines; first += half * 2)
+        {
+            for (int i = first; i < first + half; ++i)
+            {
+                auto* a = scratch.getWritePointer (i);
+                auto* b = scratch.getWritePointer (i + half);
+
+                juce::FloatVectorOperations::copy (temp, a, numSamples);
+                juce::FloatVectorOperations::add (a, b, numSamples);
+                juce::FloatVectorOperations::subtract (b, temp, b, numSamples);
+            }
+        }
+    }
+}
+
+//==============================================================================
+void FdnReverb::fillRamp (juce::SmoothedValue<float>& value, float* dest, int numSamples) noexcept
+{
+    if (! value.isSmoothing())
+    {
+        juce::FloatVectorOperations::fill (dest, value.getCurrentValue(), numSamples);
+        return;
+    }
+
+    for (int n = 0; n < numSamples; ++n)
+        dest[n] = value.getNextValue();
+}
+
+void FdnReverb::writeToRing (float* ring, int ringSize, int writePosition, const float* source, int numSamples) noexcept
+{
+    const auto numToEnd = juce::jmin (numSamples, ringSize - writePosition);
+    std::copy (source, source + numToEnd, ring + writePosition);
+    std::copy (source + numToEnd, source + numSamples, ring);
+}
+
+void FdnReverb::readFromRing (const float* ring, int ringSize, int readPosition, float* dest, int numSamples) noexcept
+{
+    const auto numToEnd = juce::jmin (numSamples, ringSize - readPosition);
+    std::copy (ring + readPosition, ring + readPosition + numToEnd, dest);
+    std::copy (ring, ring + numSamples - numToEnd, dest + numToEnd);
+}
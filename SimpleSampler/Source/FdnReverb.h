@@ -0,0 +1,117 @@
+/*
+  ==============================================================================
+
+    SimpleSampler - WAV Sampler Plugin with Virtual Keyboard
+    FdnReverb.h - Stereo feedback delay network reverb
+
+    Eight delay lines feed back into each other through a Hadamard matrix,
+    with a one-pole lowpass per line for damping and a per-line gain set so
+    every line decays by 60 dB in the same time (the T60, set by room size).
+
+    The network is processed in chunks no longer than the shortest delay
+    line. Within a chunk, everything a line reads was written in an earlier
+    chunk, so each step - reading the lines, mixing, tapping the outputs and
+    writing back - is a flat vector operation over the whole chunk instead
+    of a per-sample loop over every line. Only the damping filters run
+    sample by sample.
+
+    Parameter changes ramp over 50 ms so automation doesn't click: the
+    feedback gains, damping, wet and dry levels and width follow smoothed
+    values, and a new pre-delay crossfades from the old read position to
+    the new one instead of jumping.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+ * Feedback delay network reverb with room size, damping, pre-delay and width
+ */
+class FdnReverb
+{
+public:
+    static constexpr int numLines = 8;
+    static constexpr float maxPreDelayMs = 250.0f;
+
+    struct Parameters
+    {
+        float roomSize = 0.5f;      // 0 to 1, maps to a T60 of 0.25 s to 10 s
+        float damping = 0.5f;       // 0 to 1, high frequency loss per pass
+        float preDelayMs = 0.0f;    // 0 to maxPreDelayMs
+        float width = 1.0f;         // 0 = mono, 1 = full stereo
+        float wetLevel = 0.0f;
+        float dryLevel = 1.0f;
+    };
+
+    FdnReverb() = default;
+
+    /** Allocates the delay lines; not for the audio thread. */
+    void prepare (double sampleRate, int maximumBlockSize);
+
+    /** Clears the tail and jumps to the current settings without ramping. */
+    void reset() noexcept;
+
+    bool isPrepared() const noexcept    { return prepared; }
+
+    /** Audio thread; cheap when nothing changed. Changes ramp in over the next blocks. */
+    void setParameters (const Parameters& newParameters) noexcept;
+
+    /** Processes a mono or stereo buffer in place; extra channels are left alone. */
+    void process (juce::AudioBuffer<float>& buffer) noexcept;
+
+    /** Seconds for the tail to fall by 60 dB at a given room size. */
+    static double getDecayTime (float roomSize) noexcept
+    {
+        return 0.25 * std::pow (40.0, (double) juce::jlimit (0.0f, 1.0f, roomSize));
+    }
+
+private:
+    //==============================================================================
+    void updateCoefficients() noexcept;
+    void processChunk (float* left, float* right, int numSamples) noexcept;
+    void mixLines (int numSamples) noexcept;
+    void skipRamps() noexcept;
+
+    static void fillRamp (juce::SmoothedValue<float>& value, float* dest, int numSamples) noexcept;
+    static void writeToRing (float* ring, int ringSize, int writePosition, const float* source, int numSamples) noexcept;
+    static void readFromRing (const float* ring, int ringSize, int readPosition, float* dest, int numSamples) noexcept;
+
+    //==============================================================================
+    Parameters parameters;
+    double sampleRate = 44100.0;
+    bool prepared = false;
+
+    // Delay line lengths in samples, and per-line feedback gain and damping coefficient
+    std::array<int, numLines> lineLengths {};
+    std::array<juce::SmoothedValue<float>, numLines> feedbackGains;
+    std::array<float, numLines> dampingStates {};
+    juce::SmoothedValue<float> dampingCoefficient;
+    int maxChunkSize = 0;
+
+    // Output mix, clamped and ramped
+    juce::SmoothedValue<float> wetLevel, dryLevel, width;
+
+    // One ring per line, all the same size and sharing a write position
+    std::array<std::vector<float>, numLines> lines;
+    int lineRingSize = 0, lineWritePosition = 0;
+
+    // Stereo pre-delay; while the fade ramps to 1 the input crossfades from the previous delay
+    std::array<std::vector<float>, 2> preDelay;
+    int preDelaySize = 0, preDelayWritePosition = 0, preDelaySamples = 0, previousPreDelaySamples = 0;
+    juce::SmoothedValue<float> preDelayFade;
+
+    // Per-chunk working memory: one row per line, then the delayed input, the wet output, a temporary
+    // and the per-sample damping coefficient and output gains
+    enum ScratchRow
+    {
+        inputLeftRow = numLines, inputRightRow, wetLeftRow, wetRightRow, tempRow,
+        dampingRow, dryRow, sameRow, oppositeRow, numScratchRows
+    };
+    juce::AudioBuffer<float> scratch;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (FdnReverb)
+};
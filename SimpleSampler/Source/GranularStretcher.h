@@ -0,0 +1,316 @@
+/*
+  ==============================================================================
+
+    SimpleSampler - WAV Sampler Plugin with Virtual Keyboard
+    GranularStretcher.h - Per-voice granular time-stretch
+
+    Plays a sample at one speed and a pitch set independently. A timeline
+    moves through the source at the playback speed; every hop a Hann
+    windowed grain starts at the timeline position and reads the source at
+    the pitch ratio. Grains overlap by half, so exactly two are ever
+    sounding and the cost per voice is fixed.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "VoiceKernels.h"
+
+//==============================================================================
+/**
+ * Granular time-stretch engine owned by one voice
+ */
+class GranularStretcher
+{
+public:
+    // Grain and hop lengths are in render-rate samples
+    static constexpr int grainLength = 2048;
+    static constexpr int hopLength = grainLength / 2;
+    static constexpr int maxGrains = grainLength / hopLength;
+
+    /** The sample being played and its playback bounds, in source samples. */
+    struct Source
+    {
+        const float* inL = nullptr;
+        const float* inR = nullptr;     // nullptr for a mono source
+        double endPosition = 0.0;
+        double loopStart = 0.0, loopEnd = 0.0;
+        bool looping = false;
+    };
+
+    GranularStretcher()
+    {
+        // Builds the shared window off the audio thread
+        getWindow();
+    }
+
+    //==============================================================================
+    void start (double startPosition) noexcept
+    {
+        for (auto& grain : grains)
+            grain.active = false;
+
+        timelinePosition = startPosition;
+        timelineFinished = false;
+
+        // Two grains read from the start together, one on the falling and one on the rising
+        // half of its window, so the overlap-add is already unity at the first sample and the
+        // attack isn't faded in
+        grains[0].position = startPosition;
+        grains[0].windowIndex = hopLength;
+        grains[0].active = true;
+
+        grains[1].position = startPosition;
+        grains[1].windowIndex = 0;
+        grains[1].active = true;
+
+        samplesUntilNextGrain = hopLength;
+    }
+
+    /** True once the timeline has passed the end and the last grain has faded out. */
+    bool isFinished() const noexcept
+    {
+        if (! timelineFinished)
+            return false;
+
+        for (auto& grain : grains)
+            if (grain.active)
+                return false;
+
+        return true;
+    }
+
+    //==============================================================================
+    /** Writes numSamples of overlapped grains into mixL and mixR (mixR is left alone for
+        a mono source). grainScratch must hold 2 * numSamples floats.
+
+        pitchIncrement is the source samples each grain reads per output sample;
+        timelineIncrement is how far the grain start point moves per output sample. */
+    void render (const Source& source, double pitchIncrement, double timelineIncrement,
+                 float* mixL, float* mixR, float* grainScratch, int numSamples) noexcept
+    {
+        const auto stereo = source.inR != nullptr;
+
+        juce::FloatVectorOperations::clear (mixL, numSamples);
+
+        if (stereo)
+            juce::FloatVectorOperations::clear (mixR, numSamples);
+
+        int numDone = 0;
+
+        while (numDone < numSamples)
+        {
+            if (samplesUntilNextGrain == 0)
+            {
+                startGrain (source);
+                samplesUntilNextGrain = hopLength;
+            }
+
+            const auto numThisHop = juce::jmin (numSamples - numDone, samplesUntilNextGrain);
+
+            for (auto& grain : grains)
+                if (grain.active)
+                    renderGrain (grain, source, pitchIncrement,
+                                 mixL + numDone, stereo ? mixR + numDone : nullptr,
+                                 grainScratch, grainScratch + numSamples, numThisHop);
+
+            advanceTimeline (source, timelineIncrement * numThisHop);
+            samplesUntilNextGrain -= numThisHop;
+            numDone += numThisHop;
+        }
+    }
+
+private:
+    //==============================================================================
+    struct Grain
+    {
+        double position = 0.0;  // Read position in source samples
+        int windowIndex = 0;    // Samples of the window already played
+        bool active = false;
+    };
+
+    // Periodic Hann, which sums to exactly one at half overlap
+    static const float* getWindow()
+    {
+        static const auto window = []
+        {
+            std::array<float, grainLength> w;
+
+            for (int i = 0; i < grainLength; ++i)
+                w[(size_t) i] = 0.5f - 0.5f * std::cos (juce::MathConstants<float>::twoPi * (float) i / (float) grainLength);
+
+            return w;
+        }();
+
+        return window.data();
+    }
+
+    void startGrain (const Source& source) noexcept
+    {
+        if (timelineFinished || timelinePosition > source.endPosition)
+            return;
+
+        for (auto& grain : grains)
+        {
+            if (! grain.active)
+            {
+                grain.position = timelinePosition;
+                grain.windowIndex = 0;
+                grain.active = true;
+                return;
+            }
+        }
+
+        jassertfalse; // Half overlap never needs more than maxGrains
+    }
+
+    void advanceTimeline (const Source& source, double distance) noexcept
+    {
+        timelinePosition += distance;
+
+        if (source.looping)
+        {
+            if (timelinePosition >= source.loopEnd)
+                timelinePosition = source.loopStart + std::fmod (timelinePosition - source.loopStart,
+                                                                 source.loopEnd - source.loopStart);
+        }
+        else if (timelinePosition > source.endPosition)
+        {
+            timelineFinished = true;
+        }
+    }
+
+    void renderGrain (Grain& grain, const Source& source, double increment,
+                      float* mixL, float* mixR, float* scratchL, float* scratchR, int numSamples) noexcept
+    {
+        const auto num = juce::jmin (numSamples, grainLength - grain.windowIndex);
+        const auto* window = getWindow() + grain.windowIndex;
+
+        readSource (grain, source, increment, scratchL, scratchR, num);
+
+        // Window and overlap-add a whole run at a time
+        juce::FloatVectorOperations::multiply (scratchL, window, num);
+        juce::FloatVectorOperations::add (mixL, scratchL, num);
+
+        if (mixR != nullptr)
+        {
+            juce::FloatVectorOperations::multiply (scratchR, window, num);
+            juce::FloatVectorOperations::add (mixR, scratchR, num);
+        }
+
+        grain.windowIndex += num;
+
+        if (grain.windowIndex >= grainLength)
+            grain.active = false;
+    }
+
+    /** Linearly interpolates num source samples for a grain, wrapping inside the loop or
+        padding with silence past the end. */
+    static void readSource (Grain& grain, const Source& source, double increment,
+                            float* destL, float* destR, int num) noexcept
+    {
+        auto position = grain.position;
+        int numDone = 0;
+
+        while (numDone < num)
+        {
+            int numThisRun;
+
+            if (source.looping)
+            {
+                // Up to where the next tap would reach the loop end; the samples after that
+                // read it from the loop start instead
+                const auto numToSeam = VoiceKernels::detail::samplesBefore (source.loopEnd - 1.0, position, increment);
+                const auto numToLoopEnd = juce::jmax (1, VoiceKernels::detail::samplesBefore (source.loopEnd, position, increment));
+
+                numThisRun = juce::jmin (num - numDone, numToSeam);
+
+                if (numThisRun == 0)
+                {
+                    numThisRun = juce::jmin (num - numDone, numToLoopEnd - numToSeam);
+                    interpolateAcrossLoopEnd (source, destL + numDone, destR + numDone, position, increment, numThisRun);
+
+                    position += increment * numThisRun;
+                    numDone += numThisRun;
+
+                    if (position >= source.loopEnd)
+                        position = source.loopStart + std::fmod (position - source.loopStart,
+                                                                 source.loopEnd - source.loopStart);
+
+                    continue;
+                }
+            }
+            else
+            {
+                const auto n = std::floor ((source.endPosition - position) / increment) + 1.0;
+                numThisRun = juce::jmin (num - numDone, n < 0.0 ? 0 : (int) juce::jmin (n, 1.0e9));
+
+                if (numThisRun == 0)
+                {
+                    juce::FloatVectorOperations::clear (destL + numDone, num - numDone);
+
+                    if (destR != nullptr && source.inR != nullptr)
+                        juce::FloatVectorOperations::clear (destR + numDone, num - numDone);
+
+                    break;
+                }
+            }
+
+            interpolate (source.inL, destL + numDone, position, increment, numThisRun);
+
+            if (source.inR != nullptr)
+                interpolate (source.inR, destR + numDone, position, increment, numThisRun);
+
+            position += increment * numThisRun;
+            numDone += numThisRun;
+
+            if (source.looping && position >= source.loopEnd)
+                position = source.loopStart + std::fmod (position - source.loopStart,
+                                                         source.loopEnd - source.loopStart);
+        }
+
+        grain.position = position;
+    }
+
+    static void interpolate (const float* in, float* dest, double position, double increment, int num) noexcept
+    {
+        for (int i = 0; i < num; ++i)
+        {
+            const auto pos = (int) position;
+            const auto alpha = (float) (position - pos);
+            dest[i] = in[pos] * (1.0f - alpha) + in[pos + 1] * alpha;
+            position += increment;
+        }
+    }
+
+    static void interpolateAcrossLoopEnd (const Source& source, float* destL, float* destR,
+                                          double position, double increment, int num) noexcept
+    {
+        const auto loopStart = (int) source.loopStart;
+        const auto loopEnd = (int) source.loopEnd;
+
+        for (int i = 0; i < num; ++i)
+        {
+            const auto pos = (int) position;
+            const auto alpha = (float) (position - pos);
+
+            destL[i] = VoiceKernels::detail::interpolateAcrossLoopEnd<VoiceKernels::Interpolation::linear> (source.inL, pos, alpha, loopStart, loopEnd);
+
+            if (source.inR != nullptr)
+                destR[i] = VoiceKernels::detail::interpolateAcrossLoopEnd<VoiceKernels::Interpolation::linear> (source.inR, pos, alpha, loopStart, loopEnd);
+
+            position += increment;
+        }
+    }
+
+    //==============================================================================
+    std::array<Grain, maxGrains> grains;
+
+    double timelinePosition = 0.0;
+    bool timelineFinished = false;
+    int samplesUntilNextGrain = 0;
+
+    JUCE_LEAK_DETECTOR (GranularStretcher)
+};
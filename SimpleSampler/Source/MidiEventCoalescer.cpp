@@ -0,0 +1,183 @@
+/*
+  ==============================================================================
+
+    SimpleSampler - WAV Sampler Plugin with Virtual Keyboard
+    MidiEventCoalescer.cpp - Thins out MIDI floods before they reach the synth
+
+  ==============================================================================
+*/
+
+#include "MidiEventCoalescer.h"
+
+//==============================================================================
+void MidiEventCoalescer::prepare (int maxEventBytes, int maxEventsPerQuantum)
+{
+    output.ensureSize ((size_t) maxEventBytes);
+    pending.reserve ((size_t) maxEventsPerQuantum);
+    maxPending = maxEventsPerQuantum;
+    reset();
+}
+
+void MidiEventCoalescer::reset() noexcept
+{
+    output.clear();
+    pending.clear();
+    generation = 1;
+    latestValues.fill (Slot());
+    noteOns.fill (Slot());
+    notesHeld.fill (false);
+    sustainDown.fill (false);
+    sostenutoDown.fill (false);
+}
+
+//==============================================================================
+const juce::MidiBuffer& MidiEventCoalescer::process (const juce::MidiBuffer& input, int numSamples) noexcept
+{
+    const auto numQuanta = (numSamples + quantum - 1) / quantum;
+
+    // The common case: no more sub-blocks than quanta anyway
+    if (input.getNumEvents() <= numQuanta)
+    {
+        for (const auto metadata : input)
+            updateChannelState (metadata.data, metadata.numBytes);
+
+        return input;
+    }
+
+    output.clear();
+    int currentQuantum = -1;
+
+    for (const auto metadata : input)
+    {
+        const auto eventQuantum = juce::jlimit (0, juce::jmax (0, numSamples - 1), metadata.samplePosition) / quantum;
+
+        if (eventQuantum != currentQuantum)
+        {
+            flush (currentQuantum * quantum);
+            currentQuantum = eventQuantum;
+        }
+
+        addEvent (metadata.data, metadata.numBytes, currentQuantum * quantum);
+    }
+
+    flush (currentQuantum * quantum);
+    return output;
+}
+
+//==============================================================================
+bool MidiEventCoalescer::isCoalescableController (int controller) noexcept
+{
+    // Bank select, data entry and (N)RPN numbers only make sense as a sequence, and
+    // channel mode messages are commands rather than values
+    return ! (controller == 0 || controller == 32
+              || controller == 6 || controller == 38
+              || (controller >= 96 && controller <= 101)
+              || controller >= 120);
+}
+
+void MidiEventCoalescer::updateChannelState (const juce::uint8* data, int numBytes) noexcept
+{
+    if (numBytes < 3 || data[0] >= 0xf0)
+        return;
+
+    const auto status = data[0] & 0xf0;
+    const auto channel = data[0] & 0x0f;
+
+    if (status == 0x90 || status == 0x80)
+    {
+        notesHeld[(size_t) (channel * 128 + (data[1] & 0x7f))] = status == 0x90 && data[2] > 0;
+    }
+    else if (status == 0xb0)
+    {
+        if (data[1] == 64)
+            sustainDown[(size_t) channel] = data[2] >= 64;
+        else if (data[1] == 66)
+            sostenutoDown[(size_t) channel] = data[2] >= 64;
+        else if (data[1] == 120 || data[1] == 123)
+            std::fill_n (notesHeld.begin() + channel * 128, 128, false);
+    }
+}
+
+void MidiEventCoalescer::addEvent (const juce::uint8* data, int numBytes, int samplePosition) noexcept
+{
+    if ((int) pending.size() == maxPending)
+        flush (samplePosition);
+
+    const auto index = (int) pending.size();
+    pending.push_back ({ data, numBytes, true });
+
+    if (numBytes < 2 || data[0] >= 0xf0)
+        return;
+
+    const auto status = data[0] & 0xf0;
+    const auto channel = data[0] & 0x0f;
+    const auto isNoteOn = status == 0x90 && numBytes >= 3 && data[2] > 0;
+    const auto isNoteOff = status == 0x80 || (status == 0x90 && ! isNoteOn);
+
+    if (isNoteOn)
+    {
+        auto& slot = noteOnSlot (channel, data[1]);
+
+        // A note that is already sounding would be released by the note-off, so the
+        // pair can't be dropped; -1 blocks this note for the rest of the quantum
+        const auto canCancel = slot.generation != generation && ! notesHeld[(size_t) (channel * 128 + (data[1] & 0x7f))];
+        slot = { canCancel ? index : -1, generation };
+    }
+    else if (isNoteOff)
+    {
+        auto& slot = noteOnSlot (channel, data[1]);
+        const auto pedalDown = sustainDown[(size_t) channel] || sostenutoDown[(size_t) channel];
+
+        if (slot.generation == generation && slot.index >= 0 && ! pedalDown)
+        {
+            pending[(size_t) slot.index].keep = false;
+            pending.back().keep = false;
+            slot = Slot();
+        }
+    }
+    else if (status == 0xb0 && isCoalescableController (data[1]))
+    {
+        replaceLatestValue (channel, data[1] & 0x7f, index);
+    }
+    else if (status == 0xe0)
+    {
+        replaceLatestValue (channel, pitchBendKey, index);
+    }
+    else if (status == 0xd0)
+    {
+        replaceLatestValue (channel, pressureKey, index);
+    }
+
+    updateChannelState (data, numBytes);
+}
+
+void MidiEventCoalescer::replaceLatestValue (int channel, int key, int index) noexcept
+{
+    auto& slot = latestValueSlot (channel, key);
+
+    if (slot.generation == generation)
+        pending[(size_t) slot.index].keep = false;
+
+    slot = { index, generation };
+}
+
+void MidiEventCoalescer::flush (int samplePosition) noexcept
+{
+    if (pending.empty())
+        return;
+
+    // Events sharing a time stay in the order they were added
+    for (const auto& event : pending)
+        if (event.keep)
+            output.addEvent (event.data, event.numBytes, samplePosition);
+
+    pending.clear();
+
+    // A new generation invalidates every slot at once
+    if (++generation == 0)
+    {
+        latestValues.fill (Slot());
+        noteOns.fill (Slot());
+        generation = 1;
+    }
+}
@@ -0,0 +1,89 @@
+/*
+  ==============================================================================
+
+    SimpleSampler - WAV Sampler Plugin with Virtual Keyboard
+    MidiEventCoalescer.h - Thins out MIDI floods before they reach the synth
+
+    The synthesiser renders up to every distinct event time, so a block
+    with thousands of events turns into thousands of tiny sub-blocks. When
+    a block holds more events than it has quanta, events are snapped to
+    the quantum grid and redundant ones are dropped:
+
+      - a note-on and its note-off in the same quantum cancel out, unless
+        that note was already sounding or a pedal is down on its channel
+      - only the last value of each continuous controller, pitch bend and
+        channel pressure per channel survives a quantum
+
+    Everything else passes through in its original order. Blocks with
+    fewer events than quanta are passed through untouched.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+ * Audio thread MIDI pre-pass that bounds the number of rendering sub-blocks
+ */
+class MidiEventCoalescer
+{
+public:
+    // Matches the synthesiser's minimum rendering subdivision
+    static constexpr int quantum = 32;
+
+    /** Preallocates for blocks of up to maxEventBytes of MIDI; not for the audio thread. */
+    void prepare (int maxEventBytes, int maxEventsPerQuantum = 4096);
+
+    void reset() noexcept;
+
+    /** Returns either the input itself or the coalesced events, valid until the next call. */
+    const juce::MidiBuffer& process (const juce::MidiBuffer& input, int numSamples) noexcept;
+
+private:
+    //==============================================================================
+    struct PendingEvent
+    {
+        const juce::uint8* data = nullptr;
+        int numBytes = 0;
+        bool keep = true;
+    };
+
+    // Where the latest event of a kind was seen; only valid for the current generation
+    struct Slot
+    {
+        int index = -1;
+        juce::uint32 generation = 0;
+    };
+
+    static constexpr int numChannels = 16;
+    static constexpr int pitchBendKey = 128;
+    static constexpr int pressureKey = 129;
+    static constexpr int keysPerChannel = 130;
+
+    static bool isCoalescableController (int controller) noexcept;
+
+    void updateChannelState (const juce::uint8* data, int numBytes) noexcept;
+    void addEvent (const juce::uint8* data, int numBytes, int samplePosition) noexcept;
+    void replaceLatestValue (int channel, int key, int index) noexcept;
+    void flush (int samplePosition) noexcept;
+    Slot& latestValueSlot (int channel, int key) noexcept   { return latestValues[(size_t) (channel * keysPerChannel + key)]; }
+    Slot& noteOnSlot (int channel, int note) noexcept       { return noteOns[(size_t) (channel * 128 + (note & 0x7f))]; }
+
+    //==============================================================================
+    juce::MidiBuffer output;
+    std::vector<PendingEvent> pending;
+    int maxPending = 0;
+    juce::uint32 generation = 1;
+
+    std::array<Slot, numChannels * keysPerChannel> latestValues;
+    std::array<Slot, numChannels * 128> noteOns;
+
+    // Channel state as of the events seen so far, carried across blocks
+    std::array<bool, numChannels * 128> notesHeld {};
+    std::array<bool, numChannels> sustainDown {}, sostenutoDown {};
+
+    JUCE_LEAK_DETECTOR (MidiEventCoalescer)
+};
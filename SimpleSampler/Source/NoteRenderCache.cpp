@@ -0,0 +1,249 @@
+/*
+  ==============================================================================
+
+    SimpleSampler - WAV Sampler Plugin with Virtual Keyboard
+    NoteRenderCache.cpp - Pre-resampled one-shot notes
+
+  ==============================================================================
+*/
+
+#include "NoteRenderCache.h"
+
+//==============================================================================
+NoteRenderCache::NoteRenderCache()
+    : juce::Thread ("SimpleSampler Note Render Cache")
+{
+    for (auto& slot : slots)
+        slot.store (nullptr);
+}
+
+NoteRenderCache::~NoteRenderCache()
+{
+    stop();
+}
+
+//==============================================================================
+NoteRenderCache::Entry::Ptr NoteRenderCache::lookup (const SampleData::Ptr& sample, double startPosition, double increment,
+                                                     VoiceKernels::Interpolation interpolation) noexcept
+{
+    const Key key { sample.get(), startPosition, increment, interpolation };
+
+    for (auto& slot : slots)
+    {
+        if (auto* entry = slot.load (std::memory_order_acquire))
+        {
+            if (entry->key == key)
+            {
+                entry->lastUsed.store (audioBlockCount.load (std::memory_order_relaxed), std::memory_order_relaxed);
+                numHits.fetch_add (1, std::memory_order_relaxed);
+                return entry;
+            }
+        }
+    }
+
+    numMisses.fetch_add (1, std::memory_order_relaxed);
+
+    // If the queue is full the note is simply requested again on a later trigger
+    int start1, size1, start2, size2;
+    requestFifo.prepareToWrite (1, start1, size1, start2, size2);
+
+    if (size1 > 0)
+    {
+        auto& request = requests[(size_t) start1];
+        request.sample = sample;
+        request.key = key;
+        request.generation = generation.load (std::memory_order_relaxed);
+        requestFifo.finishedWrite (1);
+    }
+
+    return nullptr;
+}
+
+//==============================================================================
+void NoteRenderCache::start()
+{
+    if (! isThreadRunning())
+        startThread();
+}
+
+void NoteRenderCache::stop()
+{
+    stopThread (2000);
+    invalidate();
+    freeRetiredEntries();
+}
+
+void NoteRenderCache::invalidate()
+{
+    const juce::ScopedLock sl (entryLock);
+    generation.fetch_add (1, std::memory_order_relaxed);
+
+    for (int i = 0; i < maxEntries; ++i)
+        retire (i);
+
+    // The retired entries are freed once no voice holds them
+    notify();
+}
+
+//==============================================================================
+void NoteRenderCache::run()
+{
+    while (! threadShouldExit())
+    {
+        buildRequestedEntries();
+        freeRetiredEntries();
+
+        // The audio thread never wakes this thread, so requests are picked up by polling
+        wait (pollIntervalMs);
+    }
+}
+
+void NoteRenderCache::buildRequestedEntries()
+{
+    while (requestFifo.getNumReady() > 0 && ! threadShouldExit())
+    {
+        int start1, size1, start2, size2;
+        requestFifo.prepareToRead (1, start1, size1, start2, size2);
+
+        // Take the sample reference out of the slot so the audio thread never drops the last one
+        Request request;
+        std::swap (request, requests[(size_t) start1]);
+        requestFifo.finishedRead (1);
+
+        if (request.generation != generation.load())
+            continue;
+
+        {
+            // Triggers that missed before the first build finished ask again
+            const juce::ScopedLock sl (entryLock);
+
+            if (std::any_of (ownedEntries.begin(), ownedEntries.end(),
+                             [&] (const Entry::Ptr& entry) { return entry != nullptr && entry->key == request.key; }))
+                continue;
+        }
+
+        if (auto entry = build (request))
+        {
+            const juce::ScopedLock sl (entryLock);
+
+            // Samples may have changed while it was being built
+            if (request.generation == generation.load())
+                publish (entry);
+        }
+    }
+}
+
+NoteRenderCache::Entry::Ptr NoteRenderCache::build (const Request& request) const
+{
+    const auto& source = request.sample->getAudio();
+    const auto numChannels = juce::jmin (2, source.getNumChannels());
+    const auto endPosition = (double) request.sample->getLength();
+    const auto& key = request.key;
+
+    if (numChannels == 0 || key.increment <= 0.0 || key.startPosition > endPosition)
+        return nullptr;
+
+    // One spare sample in case the kernel's running position lands a step past the closed form
+    const auto maxLength = std::floor ((endPosition - key.startPosition) / key.increment) + 2.0;
+
+    // Low notes of long samples could take a large share of the budget on their own
+    if (maxLength * numChannels * sizeof (float) > (double) memoryBudgetBytes / 8)
+        return nullptr;
+
+    Entry::Ptr entry = new Entry (key, request.sample, numChannels, (int) maxLength);
+
+    // The voice's own kernel with unit gain and envelope, so cached notes match uncached ones exactly
+    constexpr int chunkSize = 4096;
+    std::vector<float> unitEnvelope ((size_t) chunkSize, 1.0f);
+
+    VoiceKernels::RenderContext context;
+    context.inL = source.getReadPointer (0);
+    context.inR = numChannels > 1 ? source.getReadPointer (1) : nullptr;
+    context.outL = entry->audio.getWritePointer (0);
+    context.outR = numChannels > 1 ? entry->audio.getWritePointer (1) : nullptr;
+    context.envelope = unitEnvelope.data();
+    context.position = key.startPosition;
+    context.increment = key.increment;
+    context.endPosition = endPosition;
+    context.gainL = 1.0f;
+    context.gainR = 1.0f;
+
+    const auto kernel = VoiceKernels::getKernel (numChannels, numChannels, key.interpolation, VoiceKernels::LoopMode::oneShot);
+
+    while (entry->length < (int) maxLength && ! context.isFinished())
+        entry->length += kernel (context, juce::jmin (chunkSize, (int) maxLength - entry->length));
+
+    return entry;
+}
+
+void NoteRenderCache::publish (Entry::Ptr entry)
+{
+    auto getMemoryUsed = [this]
+    {
+        size_t total = 0;
+
+        for (auto& owned : ownedEntries)
+            if (owned != nullptr)
+                total += owned->getSizeInBytes();
+
+        return total;
+    };
+
+    auto findFreeSlot = [this]
+    {
+        for (int i = 0; i < maxEntries; ++i)
+            if (ownedEntries[(size_t) i] == nullptr)
+                return i;
+
+        return -1;
+    };
+
+    // Make room by retiring the least recently hit entries
+    while (getMemoryUsed() + entry->getSizeInBytes() > memoryBudgetBytes || findFreeSlot() < 0)
+    {
+        int oldest = -1;
+
+        for (int i = 0; i < maxEntries; ++i)
+            if (ownedEntries[(size_t) i] != nullptr
+                 && (oldest < 0 || ownedEntries[(size_t) i]->lastUsed < ownedEntries[(size_t) oldest]->lastUsed))
+                oldest = i;
+
+        if (oldest < 0)
+            return;
+
+        retire (oldest);
+    }
+
+    const auto slot = findFreeSlot();
+    entry->lastUsed = audioBlockCount.load();
+    ownedEntries[(size_t) slot] = entry;
+    slots[(size_t) slot].store (entry.get(), std::memory_order_release);
+}
+
+void NoteRenderCache::retire (int slot)
+{
+    auto& owned = ownedEntries[(size_t) slot];
+
+    if (owned == nullptr)
+        return;
+
+    slots[(size_t) slot].store (nullptr, std::memory_order_release);
+    retiredEntries.push_back ({ owned, audioBlockCount.load (std::memory_order_acquire) });
+    owned = nullptr;
+}
+
+void NoteRenderCache::freeRetiredEntries()
+{
+    const juce::ScopedLock sl (entryLock);
+    const auto blockCount = audioBlockCount.load (std::memory_order_acquire);
+
+    // Once a full block has passed, no lookup can still be about to take a reference;
+    // after that the cache's own reference being the last one means no voice uses it
+    retiredEntries.erase (std::remove_if (retiredEntries.begin(), retiredEntries.end(),
+                                          [blockCount] (const RetiredEntry& retired)
+                                          {
+                                              return blockCount - retired.retiredAtBlock >= 2
+                                                  && retired.entry->getReferenceCount() == 1;
+                                          }),
+                          retiredEntries.end());
+}
@@ -0,0 +1,159 @@
+/*
+  ==============================================================================
+
+    SimpleSampler - WAV Sampler Plugin with Virtual Keyboard
+    NoteRenderCache.h - Pre-resampled one-shot notes
+
+    Drums and one-shots trigger the same sample at the same pitch over
+    and over. On the first trigger a voice interpolates as usual and asks
+    for the note to be cached; a background thread then renders the whole
+    note at that pitch, with the same kernel the voice uses, into a buffer.
+    Later triggers play that buffer with a vectorised multiply instead of
+    interpolating, and produce exactly the same samples.
+
+    The audio thread finds entries through a fixed table of atomic
+    pointers. Entries are reference counted: a voice holds one for as long
+    as it plays from it, and the cache frees retired entries on its own
+    thread once no voice holds them and the audio thread has finished at
+    least one full block since they were retired.
+
+    The thread only runs while the cache is enabled. It polls the request
+    queue every few milliseconds rather than being woken, because waking
+    it takes the event's mutex, which the audio thread must never do.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "VoiceKernels.h"
+#include "SampleLibrary.h"
+
+//==============================================================================
+/**
+ * Lazily built, memory-bounded cache of notes rendered at a fixed pitch
+ */
+class NoteRenderCache : private juce::Thread
+{
+public:
+    static constexpr int maxEntries = 128;
+    static constexpr size_t defaultMemoryBudgetBytes = (size_t) 64 * 1024 * 1024;
+
+    /** What a note was rendered from; entries only match an identical key. */
+    struct Key
+    {
+        const SampleData* sample = nullptr;
+        double startPosition = 0.0;         // In source samples
+        double increment = 0.0;             // Source samples per output sample
+        VoiceKernels::Interpolation interpolation = VoiceKernels::Interpolation::linear;
+
+        bool operator== (const Key& other) const noexcept
+        {
+            return sample == other.sample && startPosition == other.startPosition
+                && increment == other.increment && interpolation == other.interpolation;
+        }
+    };
+
+    /** One rendered note, one channel per source channel, with unit gain and no envelope. */
+    class Entry : public juce::ReferenceCountedObject
+    {
+    public:
+        using Ptr = juce::ReferenceCountedObjectPtr<Entry>;
+
+        Entry (const Key& noteKey, SampleData::Ptr sourceData, int numChannels, int maxLength)
+            : key (noteKey), audio (numChannels, maxLength), sample (std::move (sourceData))
+        {
+            audio.clear();
+        }
+
+        const Key key;
+        juce::AudioBuffer<float> audio;
+        int length = 0;                             // Rendered samples; the note ends after the last one
+        std::atomic<juce::uint32> lastUsed { 0 };   // Audio block count of the latest hit
+
+        size_t getSizeInBytes() const noexcept
+        {
+            return (size_t) audio.getNumChannels() * (size_t) audio.getNumSamples() * sizeof (float);
+        }
+
+    private:
+        SampleData::Ptr sample;     // Keeps the key's sample pointer from being reused
+
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Entry)
+    };
+
+    NoteRenderCache();
+    ~NoteRenderCache() override;
+
+    //==============================================================================
+    // Audio thread
+
+    /** Returns the cached note, or nullptr after asking the cache thread to build it.
+        Never blocks or allocates. */
+    Entry::Ptr lookup (const SampleData::Ptr& sample, double startPosition, double increment,
+                       VoiceKernels::Interpolation interpolation) noexcept;
+
+    /** Call at the end of every processed block. */
+    void endAudioBlock() noexcept       { audioBlockCount.fetch_add (1, std::memory_order_release); }
+
+    //==============================================================================
+    // Message thread
+
+    /** Starts the cache thread if it isn't running; stop() also drops every entry. */
+    void start();
+    void stop();
+
+    /** Drops every entry, e.g. after the samples or the sample rate changed. */
+    void invalidate();
+
+    void setMemoryBudget (size_t newBudgetBytes) noexcept  { memoryBudgetBytes = newBudgetBytes; }
+
+    //==============================================================================
+    juce::int64 getNumHits() const noexcept     { return numHits.load (std::memory_order_relaxed); }
+    juce::int64 getNumMisses() const noexcept   { return numMisses.load (std::memory_order_relaxed); }
+
+private:
+    //==============================================================================
+    // How often the cache thread looks for new requests and entries to free
+    static constexpr int pollIntervalMs = 5;
+
+    struct Request
+    {
+        SampleData::Ptr sample;
+        Key key;
+        juce::uint32 generation = 0;
+    };
+
+    struct RetiredEntry
+    {
+        Entry::Ptr entry;
+        juce::uint32 retiredAtBlock = 0;
+    };
+
+    void run() override;
+
+    void buildRequestedEntries();
+    Entry::Ptr build (const Request& request) const;
+    void publish (Entry::Ptr entry);
+    void retire (int slot);
+    void freeRetiredEntries();
+
+    //==============================================================================
+    std::array<std::atomic<Entry*>, maxEntries> slots;
+    std::atomic<juce::uint32> audioBlockCount { 0 };
+    std::atomic<juce::uint32> generation { 0 };     // Bumped by invalidate()
+    std::atomic<juce::int64> numHits { 0 }, numMisses { 0 };
+
+    static constexpr int requestQueueSize = 64;
+    juce::AbstractFifo requestFifo { requestQueueSize };
+    std::array<Request, requestQueueSize> requests;
+
+    // Cache thread and message thread, under entryLock
+    juce::CriticalSection entryLock;
+    std::array<Entry::Ptr, maxEntries> ownedEntries;
+    std::vector<RetiredEntry> retiredEntries;
+    size_t memoryBudgetBytes = defaultMemoryBudgetBytes;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (NoteRenderCache)
+};
@@ -0,0 +1,196 @@
+/*
+  ==============================================================================
+
+    SimpleSampler - WAV Sampler Plugin with Virtual Keyboard
+    OutputAnalyser.cpp - Output level meters and spectrum
+
+  ==============================================================================
+*/
+
+#include "OutputAnalyser.h"
+
+//==============================================================================
+OutputAnalyser::OutputAnalyser()
+    : juce::Thread ("SimpleSampler Output Analyser")
+{
+}
+
+OutputAnalyser::~OutputAnalyser()
+{
+    stop();
+}
+
+//==============================================================================
+void OutputAnalyser::pushBlock (const juce::AudioBuffer<float>& buffer) noexcept
+{
+    if (! running.load (std::memory_order_relaxed) || buffer.getNumChannels() == 0)
+        return;
+
+    // stop() clears running and then waits for pushing to clear before freeing the FIFO,
+    // so running is checked again once pushing is visible
+    pushing = true;
+
+    if (! running)
+    {
+        pushing = false;
+        return;
+    }
+
+    const auto numSamples = buffer.getNumSamples();
+
+    int start1, size1, start2, size2;
+    fifo.prepareToWrite (numSamples, start1, size1, start2, size2);
+
+    // A mono output fills both FIFO channels
+    for (int ch = 0; ch < 2; ++ch)
+    {
+        const auto* source = buffer.getReadPointer (juce::jmin (ch, buffer.getNumChannels() - 1));
+        auto* dest = fifoBuffer.getWritePointer (ch);
+
+        if (size1 > 0)
+            std::memcpy (dest + start1, source, (size_t) size1 * sizeof (float));
+
+        if (size2 > 0)
+            std::memcpy (dest + start2, source + size1, (size_t) size2 * sizeof (float));
+    }
+
+    fifo.finishedWrite (size1 + size2);
+    pushing = false;
+}
+
+//==============================================================================
+void OutputAnalyser::start()
+{
+    if (isThreadRunning())
+        return;
+
+    fifoBuffer.setSize (2, fifoSize);
+    fft = std::make_unique<juce::dsp::FFT> (fftOrder);
+    window = std::make_unique<juce::dsp::WindowingFunction<float>> ((size_t) fftSize, juce::dsp::WindowingFunction<float>::hann);
+    history.assign ((size_t) fftSize, 0.0f);
+    fftData.assign ((size_t) fftSize * 2, 0.0f);
+
+    running = true;
+    startThread();
+}
+
+void OutputAnalyser::stop()
+{
+    running = false;
+    stopThread (2000);
+
+    // At most one block copy to wait for
+    while (pushing)
+        juce::Thread::yield();
+
+    fifoBuffer = juce::AudioBuffer<float>();
+    fft.reset();
+    window.reset();
+    history = std::vector<float>();
+    fftData = std::vector<float>();
+
+    const juce::ScopedLock sl (frameLock);
+    latestFrame = {};
+}
+
+OutputAnalyser::Frame OutputAnalyser::getLatestFrame() const
+{
+    const juce::ScopedLock sl (frameLock);
+    return latestFrame;
+}
+
+//==============================================================================
+void OutputAnalyser::run()
+{
+    // Whatever was left over from the last time the editor was open is stale
+    fifo.finishedRead (fifo.getNumReady());
+    std::fill (history.begin(), history.end(), 0.0f);
+
+    while (! threadShouldExit())
+    {
+        if (fifo.getNumReady() > 0)
+        {
+            Frame frame;
+            readFromFifo (frame);
+            updateSpectrum (frame);
+
+            const juce::ScopedLock sl (frameLock);
+            latestFrame = frame;
+        }
+
+        wait (1000 / framesPerSecond);
+    }
+}
+
+void OutputAnalyser::readFromFifo (Frame& frame)
+{
+    const auto numReady = fifo.getNumReady();
+
+    int start1, size1, start2, size2;
+    fifo.prepareToRead (numReady, start1, size1, start2, size2);
+
+    std::array<double, 2> sumOfSquares {};
+
+    auto readRange = [&] (int start, int size)
+    {
+        if (size <= 0)
+            return;
+
+        const auto* left = fifoBuffer.getReadPointer (0, start);
+        const auto* right = fifoBuffer.getReadPointer (1, start);
+
+        for (int i = 0; i < size; ++i)
+        {
+            frame.peak[0] = juce::jmax (frame.peak[0], std::abs (left[i]));
+            frame.peak[1] = juce::jmax (frame.peak[1], std::abs (right[i]));
+            sumOfSquares[0] += (double) left[i] * left[i];
+            sumOfSquares[1] += (double) right[i] * right[i];
+
+            history[(size_t) historyPosition] = 0.5f * (left[i] + right[i]);
+            historyPosition = (historyPosition + 1) % fftSize;
+        }
+    };
+
+    readRange (start1, size1);
+    readRange (start2, size2);
+    fifo.finishedRead (size1 + size2);
+
+    const auto numRead = size1 + size2;
+
+    for (size_t ch = 0; ch < 2; ++ch)
+        frame.rms[ch] = numRead > 0 ? (float) std::sqrt (sumOfSquares[ch] / numRead) : 0.0f;
+}
+
+void OutputAnalyser::updateSpectrum (Frame& frame)
+{
+    // Unroll the history ring, oldest sample first
+    const auto numToEnd = (size_t) (fftSize - historyPosition);
+    std::copy (history.begin() + historyPosition, history.end(), fftData.begin());
+    std::copy (history.begin(), history.begin() + historyPosition, fftData.begin() + (std::ptrdiff_t) numToEnd);
+    std::fill (fftData.begin() + fftSize, fftData.end(), 0.0f);
+
+    window->multiplyWithWindowingTable (fftData.data(), (size_t) fftSize);
+    fft->performFrequencyOnlyForwardTransform (fftData.data());
+
+    // A full-scale sine through a Hann window peaks at fftSize / 4
+    const auto scale = 4.0f / (float) fftSize;
+    const auto nyquist = sampleRate.load() * 0.5;
+    const auto binWidth = nyquist / (fftSize / 2);
+    const auto lowest = 20.0;
+
+    for (int band = 0; band < numSpectrumBands; ++band)
+    {
+        const auto lowFrequency = lowest * std::pow (nyquist / lowest, (double) band / numSpectrumBands);
+        const auto highFrequency = lowest * std::pow (nyquist / lowest, (double) (band + 1) / numSpectrumBands);
+
+        const auto firstBin = juce::jlimit (1, fftSize / 2, (int) (lowFrequency / binWidth));
+        const auto lastBin = juce::jlimit (firstBin, fftSize / 2, (int) (highFrequency / binWidth));
+
+        float magnitude = 0.0f;
+
+        for (int bin = firstBin; bin <= lastBin; ++bin)
+            magnitude = juce::jmax (magnitude, fftData[(size_t) bin]);
+
+        frame.spectrum[(size_t) band] = juce::Decibels::gainToDecibels (magnitude * scale, minimumDecibels);
+    }
+}
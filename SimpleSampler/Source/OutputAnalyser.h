@@ -0,0 +1,86 @@
+/*
+  ==============================================================================
+
+    SimpleSampler - WAV Sampler Plugin with Virtual Keyboard
+    OutputAnalyser.h - Output level meters and spectrum
+
+    The audio thread only copies each output block into a FIFO. A
+    background thread drains it about 30 times a second, measures peak and
+    RMS per channel, runs an FFT over the most recent samples and publishes
+    the result as a frame the editor picks up. The thread only runs while
+    an editor is open, and the FIFO and FFT buffers only exist while it
+    runs, so instances whose editor is never opened don't carry them.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+ * Background analysis of the main output for the editor's meters and spectrum
+ */
+class OutputAnalyser : private juce::Thread
+{
+public:
+    static constexpr int fftOrder = 11;
+    static constexpr int fftSize = 1 << fftOrder;
+    static constexpr int numSpectrumBands = 64;     // Log-spaced from 20 Hz to Nyquist
+    static constexpr float minimumDecibels = -100.0f;
+
+    /** One analysis result; levels are linear gain, the spectrum is in dB. */
+    struct Frame
+    {
+        std::array<float, 2> peak {};
+        std::array<float, 2> rms {};
+        std::array<float, numSpectrumBands> spectrum {};
+    };
+
+    OutputAnalyser();
+    ~OutputAnalyser() override;
+
+    void setSampleRate (double newSampleRate) noexcept    { sampleRate = newSampleRate; }
+
+    //==============================================================================
+    /** Audio thread: copies the first one or two channels into the FIFO while the analyser
+        is running, dropping whatever doesn't fit. Never blocks or allocates. */
+    void pushBlock (const juce::AudioBuffer<float>& buffer) noexcept;
+
+    //==============================================================================
+    // Message thread; start() allocates the FIFO and FFT, stop() frees them
+    void start();
+    void stop();
+
+    Frame getLatestFrame() const;
+
+private:
+    //==============================================================================
+    void run() override;
+
+    void readFromFifo (Frame& frame);
+    void updateSpectrum (Frame& frame);
+
+    //==============================================================================
+    static constexpr int fifoSize = 16384;
+    static constexpr int framesPerSecond = 30;
+
+    juce::AbstractFifo fifo { fifoSize };
+    juce::AudioBuffer<float> fifoBuffer;
+    std::atomic<bool> running { false };
+    std::atomic<bool> pushing { false };            // Set while the audio thread is in pushBlock
+    std::atomic<double> sampleRate { 44100.0 };
+
+    // Analysis thread only
+    std::unique_ptr<juce::dsp::FFT> fft;
+    std::unique_ptr<juce::dsp::WindowingFunction<float>> window;
+    std::vector<float> history;                     // Mono mix of the latest samples, circular
+    int historyPosition = 0;
+    std::vector<float> fftData;
+
+    mutable juce::CriticalSection frameLock;
+    Frame latestFrame;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (OutputAnalyser)
+};
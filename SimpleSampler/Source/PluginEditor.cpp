@@ -118,14 +118,28 @@ SimpleSamplerAudioProcessorEditor::SimpleSamplerAudioProcessorEditor (SimpleSamp
     loadButton = std::make_unique<juce::TextButton> ("Load Sample");
     loadButton->onClick = [this] { loadButtonClicked(); };
 
+    // Kit files describe several zones, or a bank of kits for program changes
+    loadKitButton = std::make_unique<juce::TextButton> ("Load Kit");
+    loadKitButton->onClick = [this] { loadKitButtonClicked(); };
+
     fileNameLabel = std::make_unique<juce::Label> ("FileNameLabel", "No sample loaded");
     fileNameLabel->setJustificationType (juce::Justification::centred);
     fileNameLabel->setColour (juce::Label::backgroundColourId, juce::Colours::darkgrey);
     fileNameLabel->setColour (juce::Label::textColourId, juce::Colours::white);
 
     addAndMakeVisible (loadButton.get());
+    addAndMakeVisible (loadKitButton.get());
     addAndMakeVisible (fileNameLabel.get());
 
+    // Create output meter and spectrum; the analyser only runs while the editor is open
+    levelMeter = std::make_unique<LevelMeter>();
+    spectrumDisplay = std::make_unique<SpectrumDisplay>();
+
+    addAndMakeVisible (levelMeter.get());
+    addAndMakeVisible (spectrumDisplay.get());
+
+    audioProcessor.getOutputAnalyser().start();
+
     // Attach sliders to parameters
     volumeAttachment = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment> (
         audioProcessor.getValueTreeState(), "volume", *volumeSlider);
@@ -143,6 +157,7 @@ SimpleSamplerAudioProcessorEditor::SimpleSamplerAudioProcessorEditor (SimpleSamp
 SimpleSamplerAudioProcessorEditor::~SimpleSamplerAudioProcessorEditor()
 {
     stopTimer();
+    audioProcessor.getOutputAnalyser().stop();
 }
 
 //==============================================================================
@@ -221,7 +236,9 @@ void SimpleSamplerAudioProcessorEditor::resized()
     auto loadArea = area.removeFromTop (60);
     loadArea.reduce (20, 10);
 
-    loadButton->setBounds (loadArea.removeFromTop (30));
+    auto buttonRow = loadArea.removeFromTop (30);
+    loadKitButton->setBounds (buttonRow.removeFromRight (120).withTrimmedLeft (5));
+    loadButton->setBounds (buttonRow);
     fileNameLabel->setBounds (loadArea);
 
     // Controls Section (bottom)
@@ -240,14 +257,45 @@ void SimpleSamplerAudioProcessorEditor::resized()
     auto reverbArea = controlsArea.removeFromLeft (sliderWidth);
     reverbArea.removeFromTop (20); // Space for label
     reverbSlider->setBounds (reverbArea);
+
+    // Output meter and spectrum fill the rest of the row
+    controlsArea.removeFromLeft (spacing);
+    levelMeter->setBounds (controlsArea.removeFromLeft (30));
+
+    controlsArea.removeFromLeft (10);
+    spectrumDisplay->setBounds (controlsArea);
 }
 
 //==============================================================================
 void SimpleSamplerAudioProcessorEditor::timerCallback()
 {
-    // Update file name label if sample was loaded
+    const auto frame = audioProcessor.getOutputAnalyser().getLatestFrame();
+    levelMeter->setLevels (frame.peak, frame.rms);
+    spectrumDisplay->setSpectrum (frame.spectrum);
+
+    updateFileNameLabel();
+}
+
+void SimpleSamplerAudioProcessorEditor::updateFileNameLabel()
+{
+    // Update file name label once a background load has finished
+    if (audioProcessor.isLoadingSample())
+        return;
+
+    if (waitingForLoad)
+    {
+        waitingForLoad = false;
+
+        if (audioProcessor.didLastLoadFail())
+        {
+            fileNameLabel->setText ("Error loading file!", juce::dontSendNotification);
+            return;
+        }
+    }
+
+    // Update file name label if sample was loaded; a failed load keeps its error showing
     auto fileName = audioProcessor.getLoadedFileName();
-    if (fileName.isNotEmpty() && fileNameLabel->getText() != fileName)
+    if (fileName.isNotEmpty() && fileNameLabel->getText() != fileName && ! audioProcessor.didLastLoadFail())
     {
         fileNameLabel->setText (fileName, juce::dontSendNotification);
     }
@@ -271,14 +319,33 @@ void SimpleSamplerAudioProcessorEditor::loadButtonClicked()
 
         if (file != juce::File{})
         {
-            if (audioProcessor.loadSample (file))
-            {
-                fileNameLabel->setText (file.getFileName(), juce::dontSendNotification);
-            }
-            else
-            {
-                fileNameLabel->setText ("Error loading file!", juce::dontSendNotification);
-            }
+            // Decoding and analysis run in the background; timerCallback shows the result
+            audioProcessor.loadSampleAsync (file);
+            waitingForLoad = true;
+            fileNameLabel->setText ("Loading...", juce::dontSendNotification);
+        }
+    });
+}
+
+void SimpleSamplerAudioProcessorEditor::loadKitButtonClicked()
+{
+    auto fileChooser = std::make_shared<juce::FileChooser> (
+        "Select a kit file to load...",
+        juce::File::getSpecialLocation (juce::File::userHomeDirectory),
+        "*.json");
+
+    auto chooserFlags = juce::FileBrowserComponent::openMode
+                      | juce::FileBrowserComponent::canSelectFiles;
+
+    fileChooser->launchAsync (chooserFlags, [this, fileChooser] (const juce::FileChooser& fc)
+    {
+        auto file = fc.getResult();
+
+        if (file != juce::File{})
+        {
+            audioProcessor.loadKitFileAsync (file);
+            waitingForLoad = true;
+            fileNameLabel->setText ("Loading...", juce::dontSendNotification);
         }
     });
 }
@@ -8,7 +8,8 @@
     - 12-key virtual keyboard with piano layout
     - Octave switching (0-8)
     - Volume and Reverb controls
-    - Sample loading with file browser
+    - Sample and kit loading with file browser
+    - Output level meter and spectrum display
 
   ==============================================================================
 */
@@ -76,6 +77,121 @@ private:
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PianoKeyButton)
 };
 
+//==============================================================================
+/**
+ * Stereo output level meter - RMS bars, decaying peak markers and a clip light
+ */
+class LevelMeter : public juce::Component
+{
+public:
+    LevelMeter() = default;
+
+    // Called at the editor's refresh rate with the latest analyser frame
+    void setLevels (const std::array<float, 2>& peak, const std::array<float, 2>& rms)
+    {
+        for (size_t ch = 0; ch < 2; ++ch)
+        {
+            displayPeak[ch] = juce::jmax (peak[ch], displayPeak[ch] * 0.95f);
+            displayRms[ch] = rms[ch];
+
+            if (peak[ch] >= 1.0f)
+                clipHoldTicks = 60;     // About a second at 60 Hz
+        }
+
+        if (clipHoldTicks > 0)
+            --clipHoldTicks;
+
+        repaint();
+    }
+
+    void paint (juce::Graphics& g) override
+    {
+        auto bounds = getLocalBounds().toFloat();
+
+        g.setColour (clipHoldTicks > 0 ? juce::Colours::red : juce::Colours::darkgrey);
+        g.fillRect (bounds.removeFromTop (6.0f));
+        bounds.removeFromTop (2.0f);
+
+        g.setColour (juce::Colours::black);
+        g.fillRect (bounds);
+
+        const auto barWidth = bounds.getWidth() / 2.0f;
+
+        for (size_t ch = 0; ch < 2; ++ch)
+        {
+            auto bar = bounds.withX (bounds.getX() + barWidth * (float) ch).withWidth (barWidth).reduced (1.0f);
+
+            g.setColour (juce::Colours::limegreen);
+            g.fillRect (bar.withTop (bar.getBottom() - bar.getHeight() * toProportion (displayRms[ch])));
+
+            g.setColour (juce::Colours::white);
+            g.fillRect (bar.withY (bar.getBottom() - bar.getHeight() * toProportion (displayPeak[ch])).withHeight (2.0f));
+        }
+    }
+
+private:
+    // -60 dB to 0 dB fills the meter
+    static float toProportion (float gain)
+    {
+        return juce::jmap (juce::Decibels::gainToDecibels (gain, -60.0f), -60.0f, 0.0f, 0.0f, 1.0f);
+    }
+
+    std::array<float, 2> displayPeak {}, displayRms {};
+    int clipHoldTicks = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (LevelMeter)
+};
+
+//==============================================================================
+/**
+ * Output spectrum display, log frequency from 20 Hz to Nyquist
+ */
+class SpectrumDisplay : public juce::Component
+{
+public:
+    SpectrumDisplay() { displayDecibels.fill (OutputAnalyser::minimumDecibels); }
+
+    // Called at the editor's refresh rate; falls back slowly so the curve doesn't flicker
+    void setSpectrum (const std::array<float, OutputAnalyser::numSpectrumBands>& spectrum)
+    {
+        for (size_t i = 0; i < spectrum.size(); ++i)
+            displayDecibels[i] = juce::jmax (spectrum[i], displayDecibels[i] - 1.5f);
+
+        repaint();
+    }
+
+    void paint (juce::Graphics& g) override
+    {
+        auto bounds = getLocalBounds().toFloat();
+
+        g.setColour (juce::Colours::black);
+        g.fillRect (bounds);
+
+        juce::Path curve;
+        const auto bandWidth = bounds.getWidth() / (float) (displayDecibels.size() - 1);
+
+        for (size_t i = 0; i < displayDecibels.size(); ++i)
+        {
+            const auto x = bounds.getX() + bandWidth * (float) i;
+            const auto y = juce::jmap (displayDecibels[i], OutputAnalyser::minimumDecibels, 0.0f,
+                                       bounds.getBottom(), bounds.getY());
+
+            if (i == 0)
+                curve.startNewSubPath (x, y);
+            else
+                curve.lineTo (x, y);
+        }
+
+        g.setColour (juce::Colours::lightblue);
+        g.strokePath (curve, juce::PathStrokeType (1.5f));
+    }
+
+private:
+    std::array<float, OutputAnalyser::numSpectrumBands> displayDecibels;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SpectrumDisplay)
+};
+
 //==============================================================================
 /**
  * Main Plugin Editor - User Interface
@@ -95,9 +211,11 @@ private:
     //==============================================================================
     // Timer callback for updating UI
     void timerCallback() override;
+    void updateFileNameLabel();
 
     // Button click handlers
     void loadButtonClicked();
+    void loadKitButtonClicked();
     void octaveUpClicked();
     void octaveDownClicked();
     void pianoKeyPressed (int noteOffset);
@@ -125,8 +243,13 @@ private:
     std::unique_ptr<juce::Label> reverbLabel;
 
     std::unique_ptr<juce::TextButton> loadButton;
+    std::unique_ptr<juce::TextButton> loadKitButton;
     std::unique_ptr<juce::Label> fileNameLabel;
 
+    // UI Components - Output metering
+    std::unique_ptr<LevelMeter> levelMeter;
+    std::unique_ptr<SpectrumDisplay> spectrumDisplay;
+
     // Parameter attachments
     std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> volumeAttachment;
     std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> reverbAttachment;
@@ -134,6 +257,7 @@ private:
     // State
     int currentOctave = 4;  // Middle octave (C4 = MIDI 60)
     std::array<int, 12> activeNotes; // Track which notes are currently playing
+    bool waitingForLoad = false;     // A sample or kit load was started from a load button
 
     //==============================================================================
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SimpleSamplerAudioProcessorEditor)
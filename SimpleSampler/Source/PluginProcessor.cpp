@@ -12,34 +12,168 @@
 
 //==============================================================================
 SimpleSamplerAudioProcessor::SimpleSamplerAudioProcessor()
-    : AudioProcessor (BusesProperties()
-                     .withOutput ("Output", juce::AudioChannelSet::stereo(), true)),
-      parameters (*this, nullptr, juce::Identifier ("SimpleSampler"),
-                  {
-                      std::make_unique<juce::AudioParameterFloat> ("volume",
-                                                                    "Volume",
-                                                                    juce::NormalisableRange<float> (0.0f, 1.0f),
-                                                                    0.7f),
-                      std::make_unique<juce::AudioParameterFloat> ("reverb",
-                                                                    "Reverb",
-                                                                    juce::NormalisableRange<float> (0.0f, 1.0f),
-                                                                    0.0f)
-                  })
-{
-    // Initialize synthesiser with 8 voices
-    for (int i = 0; i < 8; ++i)
-        synth.addVoice (new SamplerVoice());
-
-    // Register audio formats (WAV, AIFF, etc.)
-    formatManager.registerBasicFormats();
+    : AudioProcessor (createBusesProperties()),
+      parameters (*this, nullptr, juce::Identifier ("SimpleSampler"), createParameterLayout())
+{
+    synth.setProgramBank (&programBank);
+
+    // Voices, the reverb's delay lines and the loading thread are created on first use,
+    // so instances a host only scans stay cheap; a scan never calls prepareToPlay
+
+    // Events closer together than this render together; the coalescer snaps floods to the same grid
+    synth.setMinimumRenderingSubdivisions (MidiEventCoalescer::quantum);
 
     // Get parameter pointers for efficient access
     volumeParameter = parameters.getRawParameterValue ("volume");
     reverbParameter = parameters.getRawParameterValue ("reverb");
+    reverbSizeParameter = parameters.getRawParameterValue ("reverbSize");
+    reverbDampingParameter = parameters.getRawParameterValue ("reverbDamping");
+    reverbPreDelayParameter = parameters.getRawParameterValue ("reverbPreDelay");
+    reverbWidthParameter = parameters.getRawParameterValue ("reverbWidth");
+    attackParameter = parameters.getRawParameterValue ("attack");
+    decayParameter = parameters.getRawParameterValue ("decay");
+    sustainParameter = parameters.getRawParameterValue ("sustain");
+    releaseParameter = parameters.getRawParameterValue ("release");
+    curveParameter = parameters.getRawParameterValue ("curve");
+    oversamplingParameter = parameters.getRawParameterValue ("oversampling");
+    playModeParameter = parameters.getRawParameterValue ("playMode");
+    glideParameter = parameters.getRawParameterValue ("glide");
+    interpolationParameter = parameters.getRawParameterValue ("interpolation");
+    loopModeParameter = parameters.getRawParameterValue ("loopMode");
+    timeStretchParameter = parameters.getRawParameterValue ("timeStretch");
+    stretchRateParameter = parameters.getRawParameterValue ("stretchRate");
+    normaliseParameter = parameters.getRawParameterValue ("normalise");
+    startOnsetParameter = parameters.getRawParameterValue ("startOnset");
+    renderCacheParameter = parameters.getRawParameterValue ("renderCache");
+
+    // Latency changes are reported from the message thread, never from processBlock, and the
+    // note cache thread is started and stopped there too
+    parameters.addParameterListener ("oversampling", this);
+    parameters.addParameterListener ("renderCache", this);
 }
 
 SimpleSamplerAudioProcessor::~SimpleSamplerAudioProcessor()
 {
+    if (loadingPool != nullptr)
+        loadingPool->removeAllJobs (true, 10000);
+
+    parameters.removeParameterListener ("oversampling", this);
+    parameters.removeParameterListener ("renderCache", this);
+    cancelPendingUpdate();
+    stopTimer();
+}
+
+juce::AudioProcessor::BusesProperties SimpleSamplerAudioProcessor::createBusesProperties()
+{
+    // Main stereo output plus aux stereo outputs the host can enable for separate mixing
+    auto buses = BusesProperties().withOutput ("Output", juce::AudioChannelSet::stereo(), true);
+
+    for (int i = 1; i <= numAuxOutputBuses; ++i)
+        buses = buses.withOutput ("Aux " + juce::String (i), juce::AudioChannelSet::stereo(), false);
+
+    return buses;
+}
+
+juce::AudioProcessorValueTreeState::ParameterLayout SimpleSamplerAudioProcessor::createParameterLayout()
+{
+    // Envelope times use a skewed range so short settings get most of the travel
+    juce::NormalisableRange<float> envelopeTimeRange (0.0f, 10.0f);
+    envelopeTimeRange.setSkewForCentre (0.5f);
+
+    juce::NormalisableRange<float> glideTimeRange (0.0f, 2.0f);
+    glideTimeRange.setSkewForCentre (0.2f);
+
+    // Centred on original speed so halving and doubling are equally far away
+    juce::NormalisableRange<float> stretchRateRange (0.25f, 4.0f);
+    stretchRateRange.setSkewForCentre (1.0f);
+
+    return {
+        std::make_unique<juce::AudioParameterFloat> ("volume",
+                                                      "Volume",
+                                                      juce::NormalisableRange<float> (0.0f, 1.0f),
+                                                      0.7f),
+        std::make_unique<juce::AudioParameterFloat> ("reverb",
+                                                      "Reverb",
+                                                      juce::NormalisableRange<float> (0.0f, 1.0f),
+                                                      0.0f),
+        std::make_unique<juce::AudioParameterFloat> ("reverbSize",
+                                                      "Reverb Size",
+                                                      juce::NormalisableRange<float> (0.0f, 1.0f),
+                                                      0.5f),
+        std::make_unique<juce::AudioParameterFloat> ("reverbDamping",
+                                                      "Reverb Damping",
+                                                      juce::NormalisableRange<float> (0.0f, 1.0f),
+                                                      0.5f),
+        std::make_unique<juce::AudioParameterFloat> ("reverbPreDelay",
+                                                      "Reverb Pre-Delay",
+                                                      juce::NormalisableRange<float> (0.0f, FdnReverb::maxPreDelayMs, 0.1f, 0.5f),
+                                                      0.0f),
+        std::make_unique<juce::AudioParameterFloat> ("reverbWidth",
+                                                      "Reverb Width",
+                                                      juce::NormalisableRange<float> (0.0f, 1.0f),
+                                                      1.0f),
+        std::make_unique<juce::AudioParameterFloat> ("attack",
+                                                      "Attack",
+                                                      envelopeTimeRange,
+                                                      0.01f),
+        std::make_unique<juce::AudioParameterFloat> ("decay",
+                                                      "Decay",
+                                                      envelopeTimeRange,
+                                                      0.1f),
+        std::make_unique<juce::AudioParameterFloat> ("sustain",
+                                                      "Sustain",
+                                                      juce::NormalisableRange<float> (0.0f, 1.0f),
+                                                      1.0f),
+        std::make_unique<juce::AudioParameterFloat> ("release",
+                                                      "Release",
+                                                      envelopeTimeRange,
+                                                      0.1f),
+        std::make_unique<juce::AudioParameterFloat> ("curve",
+                                                      "Envelope Curve",
+                                                      juce::NormalisableRange<float> (0.0f, 1.0f),
+                                                      0.5f),
+        std::make_unique<juce::AudioParameterChoice> ("oversampling",
+                                                       "Oversampling",
+                                                       juce::StringArray { "Off", "2x", "4x" },
+                                                       0),
+        std::make_unique<juce::AudioParameterChoice> ("playMode",
+                                                       "Play Mode",
+                                                       juce::StringArray { "Poly", "Mono", "Legato" },
+                                                       0),
+        std::make_unique<juce::AudioParameterFloat> ("glide",
+                                                      "Glide",
+                                                      glideTimeRange,
+                                                      0.0f),
+        std::make_unique<juce::AudioParameterChoice> ("interpolation",
+                                                       "Interpolation",
+                                                       juce::StringArray { "Linear", "Cubic" },
+                                                       0),
+        std::make_unique<juce::AudioParameterChoice> ("loopMode",
+                                                       "Loop Mode",
+                                                       juce::StringArray { "Off", "Forward" },
+                                                       0),
+        std::make_unique<juce::AudioParameterChoice> ("timeStretch",
+                                                       "Time Stretch",
+                                                       juce::StringArray { "Off", "Granular" },
+                                                       0),
+        std::make_unique<juce::AudioParameterFloat> ("stretchRate",
+                                                      "Stretch Rate",
+                                                      stretchRateRange,
+                                                      1.0f),
+        std::make_unique<juce::AudioParameterChoice> ("normalise",
+                                                       "Normalise",
+                                                       juce::StringArray { "Off", "On" },
+                                                       0),
+        std::make_unique<juce::AudioParameterInt> ("startOnset",
+                                                    "Start Onset",
+                                                    0,
+                                                    32,
+                                                    0),
+        std::make_unique<juce::AudioParameterChoice> ("renderCache",
+                                                       "Note Cache",
+                                                       juce::StringArray { "Off", "On" },
+                                                       0)
+    };
 }
 
 //==============================================================================
@@ -65,69 +199,177 @@ bool SimpleSamplerAudioProcessor::isMidiEffect() const
 
 double SimpleSamplerAudioProcessor::getTailLengthSeconds() const
 {
-    return 0.0;
+    // After the last note-off the longest a voice can ring is its release
+    auto tail = (double) releaseParameter->load();
+
+    // processBlock skips the reverb at this mix and below, so it adds nothing
+    if (reverbParameter->load() > 0.01f)
+        tail += FdnReverb::getDecayTime (reverbSizeParameter->load()) + reverbPreDelayParameter->load() / 1000.0;
+
+    return tail;
 }
 
 int SimpleSamplerAudioProcessor::getNumPrograms()
 {
-    return 1;
+    return programBank.getNumPrograms();
 }
 
 int SimpleSamplerAudioProcessor::getCurrentProgram()
 {
-    return 0;
+    // A switch the audio thread hasn't picked up yet already counts
+    const auto requested = requestedProgram.load();
+    return requested >= 0 ? requested : synth.getCurrentProgram();
 }
 
 void SimpleSamplerAudioProcessor::setCurrentProgram (int index)
 {
-    juce::ignoreUnused (index);
+    // Applied by the audio thread at the start of the next block. Empty slots are ignored, as
+    // selectProgram does, so getCurrentProgram never reports one and a load can't land in it
+    if (programBank.getKit (index) != nullptr)
+        requestedProgram = index;
 }
 
 const juce::String SimpleSamplerAudioProcessor::getProgramName (int index)
 {
-    juce::ignoreUnused (index);
-    return {};
+    return programBank.getProgramName (index);
 }
 
 void SimpleSamplerAudioProcessor::changeProgramName (int index, const juce::String& newName)
 {
-    juce::ignoreUnused (index, newName);
+    programBank.setProgramName (index, newName);
 }
 
 //==============================================================================
 void SimpleSamplerAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
 {
-    // Initialize synthesiser
+    // Initialize synthesiser; voices are added on the first call, before the voice
+    // scratch below is sized for them
+    if (synth.getNumVoices() == 0)
+        for (int i = 0; i < polyphony; ++i)
+            synth.addSamplerVoice (new SamplerVoice())->setRenderCache (&renderCache);
+
     synth.setCurrentPlaybackSampleRate (sampleRate);
+    updateOutputBuses();
+    outputAnalyser.setSampleRate (sampleRate);
+
+    // Cached notes were rendered for the old rate
+    renderCache.invalidate();
+    prepared = true;
+    applyRenderCacheChoice();
+
+    // Initialize reverb (main output only), whether or not it is on yet, so turning it on
+    // during playback or in an offline render never waits for an allocation
+    reverb.prepare (sampleRate, samplesPerBlock);
 
-    // Initialize reverb
+    // Voices render into every output channel, so oversampling covers all buses
     juce::dsp::ProcessSpec spec;
     spec.sampleRate = sampleRate;
     spec.maximumBlockSize = static_cast<juce::uint32> (samplesPerBlock);
     spec.numChannels = static_cast<juce::uint32> (getTotalNumOutputChannels());
 
-    reverb.prepare (spec);
+    // Initialize oversampling - polyphase IIR half-band stages with integer latency
+    for (size_t i = 0; i < oversamplers.size(); ++i)
+    {
+        oversamplers[i] = std::make_unique<juce::dsp::Oversampling<float>> (
+            spec.numChannels,
+            i + 1,
+            juce::dsp::Oversampling<float>::filterHalfBandPolyphaseIIR,
+            true,
+            true);
+
+        oversamplers[i]->initProcessing (spec.maximumBlockSize);
+    }
+
+    int maximumLatency = 0;
+
+    for (auto& oversampler : oversamplers)
+        maximumLatency = juce::jmax (maximumLatency, juce::roundToInt (oversampler->getLatencyInSamples()));
+
+    latencyCompensation.prepare (spec);
+    latencyCompensation.setMaximumDelayInSamples (maximumLatency + 1);
+
+    // Audio thread working memory: voice scratch and the oversampling scratch buffer come
+    // from one arena; MIDI scratch buffers reserve their capacity up front
+    const auto numOutputChannels = (size_t) spec.numChannels;
+    const auto numVoices = (size_t) synth.getNumVoices();
+
+    arena.allocate (RealtimeArena::bytesFor<float> ((size_t) SamplerVoice::scratchSize) * numVoices
+                  + RealtimeArena::bytesFor<float*> (numOutputChannels)
+                  + RealtimeArena::bytesFor<float> ((size_t) samplesPerBlock) * numOutputChannels);
+
+    for (int i = 0; i < synth.getNumVoices(); ++i)
+        if (auto* voice = dynamic_cast<SamplerVoice*> (synth.getVoice (i)))
+            voice->setScratchBuffer (arena.take<float> ((size_t) SamplerVoice::scratchSize));
+
+    auto** scratchChannels = arena.take<float*> (numOutputChannels);
+
+    for (size_t ch = 0; ch < numOutputChannels; ++ch)
+        scratchChannels[ch] = arena.take<float> ((size_t) samplesPerBlock);
+
+    oversamplingScratch.setDataToReferTo (scratchChannels, (int) numOutputChannels, samplesPerBlock);
+
+    midiScratch.ensureSize (midiScratchBytes);
+    oversampledMidi.ensureSize (midiScratchBytes);
+    midiCoalescer.prepare (midiScratchBytes);
+
+    // Nothing is playing yet, so the choice and its latency can be applied right here
+    const auto choice = juce::jlimit (0, (int) oversamplers.size(), juce::roundToInt (oversamplingParameter->load()));
+    appliedOversamplingChoice = choice;
+    setOversamplingChoice (choice);
+    setLatencySamples (getOversamplingLatency (choice));
 }
 
 void SimpleSamplerAudioProcessor::releaseResources()
 {
     // Release any resources that were allocated in prepareToPlay()
+    prepared = false;
+    renderCache.stop();
 }
 
 bool SimpleSamplerAudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts) const
 {
-    // Only supports mono and stereo
+    // Main output supports mono and stereo
     if (layouts.getMainOutputChannelSet() != juce::AudioChannelSet::mono()
      && layouts.getMainOutputChannelSet() != juce::AudioChannelSet::stereo())
         return false;
 
+    // Aux outputs are stereo or disabled
+    for (int bus = 1; bus < layouts.outputBuses.size(); ++bus)
+    {
+        const auto set = layouts.getChannelSet (false, bus);
+
+        if (! set.isDisabled() && set != juce::AudioChannelSet::stereo())
+            return false;
+    }
+
     return true;
 }
 
+void SimpleSamplerAudioProcessor::updateOutputBuses()
+{
+    std::array<SamplerSynthesiser::OutputBus, SamplerSynthesiser::maxOutputBuses> buses;
+    const int numBuses = juce::jmin (getBusCount (false), SamplerSynthesiser::maxOutputBuses);
+
+    for (int i = 0; i < numBuses; ++i)
+    {
+        auto* bus = getBus (false, i);
+
+        if (bus != nullptr && bus->isEnabled())
+        {
+            buses[(size_t) i].firstChannel = getChannelIndexInProcessBlockBuffer (false, i, 0);
+            buses[(size_t) i].numChannels = bus->getNumberOfChannels();
+        }
+    }
+
+    synth.setOutputBuses (buses, numBuses);
+}
+
 void SimpleSamplerAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer,
                                                 juce::MidiBuffer& midiMessages)
 {
     juce::ScopedNoDenormals noDenormals;
+    RealtimeCheck::ScopedAudioThread audioThread;
+
     auto totalNumInputChannels  = getTotalNumInputChannels();
     auto totalNumOutputChannels = getTotalNumOutputChannels();
 
@@ -135,18 +377,34 @@ void SimpleSamplerAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer
     for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
         buffer.clear (i, 0, buffer.getNumSamples());
 
-    // Merge virtual keyboard MIDI with incoming MIDI
+    // Merge virtual keyboard MIDI with incoming MIDI into the preallocated scratch buffer,
+    // dropping whatever doesn't fit rather than growing it
+    midiScratch.clear();
+
+    for (const auto metadata : midiMessages)
     {
-        juce::ScopedLock lock (virtualKeyboardLock);
-        if (!virtualKeyboardMidi.isEmpty())
-        {
-            midiMessages.addEvents (virtualKeyboardMidi, 0, buffer.getNumSamples(), 0);
-            virtualKeyboardMidi.clear();
-        }
+        if (metadata.samplePosition >= buffer.getNumSamples())
+            break;
+
+        if (metadata.samplePosition >= 0)
+            addScratchMidiEvent (metadata.data, metadata.numBytes, metadata.samplePosition);
     }
 
+    readKeyboardEvents();
+
+    // With realtime checks on, holds the synthesiser lock across all of rendering, so a
+    // message thread call that takes it at any point in the block is caught
+    const RealtimeCheck::ScopedCheckedLock synthLock (synth.getLock(), "synthesiser lock held by another thread");
+
     // Render synthesiser audio
-    synth.renderNextBlock (buffer, midiMessages, 0, buffer.getNumSamples());
+    // Host program selection; MIDI program changes are handled inside the synthesiser
+    const auto program = requestedProgram.exchange (-1);
+
+    if (program >= 0)
+        synth.selectProgram (program);
+
+    updateVoiceParameters();
+    renderVoices (buffer, midiCoalescer.process (midiScratch, buffer.getNumSamples()));
 
     // Apply volume control
     float volume = volumeParameter->load();
@@ -157,21 +415,260 @@ void SimpleSamplerAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer
 
     if (reverbMix > 0.01f) // Only process if reverb is actually being used
     {
+        auto mainOutput = getBusBuffer (buffer, false, 0);
+
         // Set reverb parameters
-        juce::Reverb::Parameters reverbParams;
-        reverbParams.roomSize   = 0.5f;
-        reverbParams.damping    = 0.5f;
+        FdnReverb::Parameters reverbParams;
+        reverbParams.roomSize   = reverbSizeParameter->load();
+        reverbParams.damping    = reverbDampingParameter->load();
+        reverbParams.preDelayMs = reverbPreDelayParameter->load();
+        reverbParams.width      = reverbWidthParameter->load();
         reverbParams.wetLevel   = reverbMix;
         reverbParams.dryLevel   = 1.0f - reverbMix;
-        reverbParams.width      = 1.0f;
-        reverbParams.freezeMode = 0.0f;
 
-        reverb.state->setParameters (reverbParams);
+        reverb.setParameters (reverbParams);
 
         // Process reverb
-        juce::dsp::AudioBlock<float> block (buffer);
-        juce::dsp::ProcessContextReplacing<float> context (block);
-        reverb.process (context);
+        reverb.process (mainOutput);
+    }
+
+    // Only a copy into a FIFO; the analysis runs on its own thread while the editor is open
+    outputAnalyser.pushBlock (getBusBuffer (buffer, false, 0));
+
+    renderCache.endAudioBlock();
+    audioBlockCount.fetch_add (1, std::memory_order_release);
+}
+
+void SimpleSamplerAudioProcessor::updateVoiceParameters()
+{
+    EnvelopeGenerator::Parameters envelopeParameters;
+    envelopeParameters.attack  = attackParameter->load();
+    envelopeParameters.decay   = decayParameter->load();
+    envelopeParameters.sustain = sustainParameter->load();
+    envelopeParameters.release = releaseParameter->load();
+    envelopeParameters.curve   = curveParameter->load();
+
+    const auto interpolation = juce::roundToInt (interpolationParameter->load()) == 1 ? VoiceKernels::Interpolation::cubic
+                                                                                       : VoiceKernels::Interpolation::linear;
+    const auto loopMode = juce::roundToInt (loopModeParameter->load()) == 1 ? VoiceKernels::LoopMode::forward
+                                                                           : VoiceKernels::LoopMode::oneShot;
+    const auto timeStretch = juce::roundToInt (timeStretchParameter->load()) == 1;
+    const auto stretchRate = (double) stretchRateParameter->load();
+    const auto normalise = juce::roundToInt (normaliseParameter->load()) == 1;
+    const auto startOnset = juce::roundToInt (startOnsetParameter->load());
+    const auto useRenderCache = juce::roundToInt (renderCacheParameter->load()) == 1;
+
+    for (int i = 0; i < synth.getNumVoices(); ++i)
+    {
+        if (auto* voice = dynamic_cast<SamplerVoice*> (synth.getVoice (i)))
+        {
+            voice->setEnvelopeParameters (envelopeParameters);
+            voice->setPlaybackOptions (interpolation, loopMode);
+            voice->setTimeStretch (timeStretch, stretchRate);
+            voice->setStartOptions (normalise, startOnset);
+            voice->setRenderCacheEnabled (useRenderCache);
+        }
+    }
+
+    synth.setPlayMode (static_cast<SamplerSynthesiser::PlayMode> (juce::jlimit (0, 2, juce::roundToInt (playModeParameter->load()))));
+    synth.setGlideTime (glideParameter->load());
+}
+
+//==============================================================================
+// Oversampling
+void SimpleSamplerAudioProcessor::renderVoices (juce::AudioBuffer<float>& buffer,
+                                                const juce::MidiBuffer& midiMessages)
+{
+    const int numSamples = buffer.getNumSamples();
+    const int choice = appliedOversamplingChoice.load();
+
+    // Both oversamplers are prepared, so switching only changes which path renders
+    if (choice != oversamplingChoice)
+        setOversamplingChoice (choice);
+
+    if (oversamplingChoice == 0)
+    {
+        setVoiceOversamplingFactor (1);
+        synth.renderNextBlock (buffer, midiMessages, 0, numSamples);
+        return;
+    }
+
+    auto& oversampler = *oversamplers[(size_t) oversamplingChoice - 1];
+    const bool shouldOversample = needsOversampling (midiMessages);
+    const bool switched = shouldOversample != oversamplingActive;
+    oversamplingActive = shouldOversample;
+
+    const auto numChannels = (size_t) juce::jmin (buffer.getNumChannels(), oversamplingScratch.getNumChannels());
+    auto outputBlock = juce::dsp::AudioBlock<float> (buffer).getSubsetChannelBlock (0, numChannels);
+
+    if (oversamplingActive)
+    {
+        if (switched)
+            oversampler.reset();
+
+        // The buffer is silent here, so this only positions the oversampler's internal buffer
+        auto oversampledBlock = oversampler.processSamplesUp (outputBlock);
+        oversampledBlock.clear();
+
+        renderOversampled (oversampledBlock, midiMessages, (int) oversampler.getOversamplingFactor());
+        oversampler.processSamplesDown (outputBlock);
+
+        // Samples still inside the direct path's delay play out underneath
+        if (switched)
+            drainLatencyCompensation (buffer);
+    }
+    else
+    {
+        if (switched)
+            latencyCompensation.reset();
+
+        setVoiceOversamplingFactor (1);
+        synth.renderNextBlock (buffer, midiMessages, 0, numSamples);
+
+        juce::dsp::ProcessContextReplacing<float> context (outputBlock);
+        latencyCompensation.process (context);
+
+        // Likewise for the oversampler's filter tails
+        if (switched)
+            drainOversampler (oversampler, buffer);
+    }
+}
+
+void SimpleSamplerAudioProcessor::renderOversampled (juce::dsp::AudioBlock<float>& oversampledBlock,
+                                                     const juce::MidiBuffer& midiMessages,
+                                                     int factor)
+{
+    // Event times move to the oversampled timeline
+    oversampledMidi.clear();
+
+    for (const auto metadata : midiMessages)
+        oversampledMidi.addEvent (metadata.data, metadata.numBytes, metadata.samplePosition * factor);
+
+    // Wrap the oversampler's channels so the synthesiser can render straight into them
+    std::array<float*, 32> channels {};
+    const auto numChannels = juce::jmin ((int) oversampledBlock.getNumChannels(), (int) channels.size());
+
+    for (int ch = 0; ch < numChannels; ++ch)
+        channels[(size_t) ch] = oversampledBlock.getChannelPointer ((size_t) ch);
+
+    juce::AudioBuffer<float> oversampledBuffer (channels.data(), numChannels, (int) oversampledBlock.getNumSamples());
+
+    setVoiceOversamplingFactor (factor);
+    synth.renderNextBlock (oversampledBuffer, oversampledMidi, 0, oversampledBuffer.getNumSamples());
+}
+
+bool SimpleSamplerAudioProcessor::needsOversampling (const juce::MidiBuffer& midiMessages)
+{
+    for (int i = 0; i < synth.getNumVoices(); ++i)
+        if (auto* voice = dynamic_cast<SamplerVoice*> (synth.getVoice (i)))
+            if (voice->isVoiceActive() && voice->getPitchRatio() > oversamplingPitchThreshold)
+                return true;
+
+    // Notes starting in this block count too, so their attack is already oversampled
+    for (const auto metadata : midiMessages)
+    {
+        const auto message = metadata.getMessage();
+
+        if (! message.isNoteOn())
+            continue;
+
+        for (auto* activeSound : synth.getActiveSounds())
+            if (auto* sound = dynamic_cast<SamplerSound*> (activeSound))
+                if (sound->appliesToNote (message.getNoteNumber())
+                     && sound->getPitchRatio (message.getNoteNumber(), getSampleRate()) > oversamplingPitchThreshold)
+                    return true;
+    }
+
+    return false;
+}
+
+void SimpleSamplerAudioProcessor::parameterChanged (const juce::String& parameterID, float)
+{
+    // Hosts may automate from the audio thread, so the choice is always applied asynchronously
+    if (parameterID == "oversampling" || parameterID == "renderCache")
+        triggerAsyncUpdate();
+}
+
+void SimpleSamplerAudioProcessor::applyRenderCacheChoice()
+{
+    // The cache thread only runs while the cache is on and the processor is prepared
+    if (prepared && juce::roundToInt (renderCacheParameter->load()) == 1)
+        renderCache.start();
+    else
+        renderCache.stop();
+}
+
+void SimpleSamplerAudioProcessor::applyOversamplingChoice()
+{
+    // Before the first prepareToPlay there is nothing to switch; it applies the choice itself
+    if (oversamplers[0] == nullptr)
+        return;
+
+    const auto choice = juce::jlimit (0, (int) oversamplers.size(), juce::roundToInt (oversamplingParameter->load()));
+
+    if (choice == appliedOversamplingChoice.load())
+        return;
+
+    // The host hears about the new latency before the audio thread starts using it
+    setLatencySamples (getOversamplingLatency (choice));
+    appliedOversamplingChoice = choice;
+}
+
+int SimpleSamplerAudioProcessor::getOversamplingLatency (int choice) const
+{
+    // Reported whenever oversampling is enabled, even while idle
+    if (choice > 0 && oversamplers[(size_t) choice - 1] != nullptr)
+        return juce::roundToInt (oversamplers[(size_t) choice - 1]->getLatencyInSamples());
+
+    return 0;
+}
+
+void SimpleSamplerAudioProcessor::setOversamplingChoice (int newChoice)
+{
+    // Audio thread (or prepareToPlay). The oversampler that takes over is reset when it
+    // next becomes active, so only the direct path's delay needs adjusting here.
+    oversamplingChoice = newChoice;
+    oversamplingActive = false;
+
+    latencyCompensation.reset();
+    latencyCompensation.setDelay ((float) getOversamplingLatency (oversamplingChoice));
+}
+
+void SimpleSamplerAudioProcessor::setVoiceOversamplingFactor (int factor)
+{
+    for (int i = 0; i < synth.getNumVoices(); ++i)
+        if (auto* voice = dynamic_cast<SamplerVoice*> (synth.getVoice (i)))
+            voice->setOversamplingFactor (factor);
+}
+
+void SimpleSamplerAudioProcessor::drainOversampler (juce::dsp::Oversampling<float>& oversampler,
+                                                    juce::AudioBuffer<float>& buffer)
+{
+    const int numSamples = buffer.getNumSamples();
+    oversamplingScratch.clear();
+
+    auto scratchBlock = juce::dsp::AudioBlock<float> (oversamplingScratch).getSubBlock (0, (size_t) numSamples);
+    auto oversampledBlock = oversampler.processSamplesUp (scratchBlock);
+    oversampledBlock.clear();
+    oversampler.processSamplesDown (scratchBlock);
+
+    for (int ch = 0; ch < oversamplingScratch.getNumChannels(); ++ch)
+        buffer.addFrom (ch, 0, oversamplingScratch, ch, 0, numSamples);
+}
+
+void SimpleSamplerAudioProcessor::drainLatencyCompensation (juce::AudioBuffer<float>& buffer)
+{
+    const int numChannels = juce::jmin (buffer.getNumChannels(), oversamplingScratch.getNumChannels());
+
+    for (int ch = 0; ch < numChannels; ++ch)
+    {
+        auto* data = buffer.getWritePointer (ch);
+
+        for (int i = 0; i < buffer.getNumSamples(); ++i)
+        {
+            latencyCompensation.pushSample (ch, 0.0f);
+            data[i] += latencyCompensation.popSample (ch);
+        }
     }
 }
 
@@ -189,8 +686,26 @@ juce::AudioProcessorEditor* SimpleSamplerAudioProcessor::createEditor()
 //==============================================================================
 void SimpleSamplerAudioProcessor::getStateInformation (juce::MemoryBlock& destData)
 {
-    // Save parameters to memory block
+    // Save parameters to memory block, with the files and zones of every loaded kit
     auto state = parameters.copyState();
+    state.removeChild (state.getChildWithName ("Programs"), nullptr);
+
+    juce::ValueTree programs ("Programs");
+    programs.setProperty ("current", getCurrentProgram(), nullptr);
+
+    for (int program = 0; program < ProgramBank::maxPrograms; ++program)
+    {
+        if (auto* kit = programBank.getKit (program))
+        {
+            auto kitState = kit->getDescription().createCopy();
+            kitState.setProperty ("program", program, nullptr);
+            kitState.setProperty ("name", kit->getName(), nullptr);     // May have been renamed since
+            programs.appendChild (kitState, nullptr);
+        }
+    }
+
+    state.appendChild (programs, nullptr);
+
     std::unique_ptr<juce::XmlElement> xml (state.createXml());
     copyXmlToBinary (*xml, destData);
 }
@@ -200,69 +715,507 @@ void SimpleSamplerAudioProcessor::setStateInformation (const void* data, int siz
     // Restore parameters from memory block
     std::unique_ptr<juce::XmlElement> xmlState (getXmlFromBinary (data, sizeInBytes));
 
-    if (xmlState.get() != nullptr)
-        if (xmlState->hasTagName (parameters.state.getType()))
-            parameters.replaceState (juce::ValueTree::fromXml (*xmlState));
+    if (xmlState.get() == nullptr || ! xmlState->hasTagName (parameters.state.getType()))
+        return;
+
+    auto state = juce::ValueTree::fromXml (*xmlState);
+    const auto programs = state.getChildWithName ("Programs");
+    state.removeChild (programs, nullptr);
+    parameters.replaceState (state);
+
+    // Kits are decoded here rather than in the background, so a host saving again straight
+    // after restoring never saves an empty bank. A kit whose files have gone is skipped.
+    auto allLoaded = true;
+
+    for (const auto& kitState : programs)
+    {
+        const auto description = readKitState (kitState);
+        auto kit = createKit (description);
+        allLoaded = kit != nullptr && installKit (description.program, kit) && allLoaded;
+    }
+
+    lastLoadFailed = ! allLoaded;
+
+    if (programs.hasProperty ("current"))
+        setCurrentProgram ((int) programs["current"]);
 }
 
 //==============================================================================
 // Sample loading
 bool SimpleSamplerAudioProcessor::loadSample (const juce::File& file)
 {
-    // Check if file exists
-    if (!file.existsAsFile())
+    auto kit = createSingleSampleKit (file);
+    return kit != nullptr && installKit (getCurrentProgram(), kit);
+}
+
+void SimpleSamplerAudioProcessor::loadSampleAsync (const juce::File& file)
+{
+    ++numPendingLoads;
+    const auto program = getCurrentProgram();
+
+    if (loadingPool == nullptr)
+        loadingPool = std::make_unique<juce::ThreadPool> (1);
+
+    loadingPool->addJob ([this, file, program]
+    {
+        FinishedLoad load;
+        load.kits.push_back ({ program, createSingleSampleKit (file) });
+
+        {
+            // Jobs run in order on one thread, so loads are installed in the order they were started
+            const juce::ScopedLock sl (pendingLoadLock);
+            finishedLoads.push_back (std::move (load));
+        }
+
+        triggerAsyncUpdate();
+    });
+}
+
+juce::Result SimpleSamplerAudioProcessor::loadKitFile (const juce::File& file)
+{
+    juce::Array<KitDescription> kits;
+    const auto result = readKitFile (file, getCurrentProgram(), kits);
+
+    if (result.failed())
+        return result;
+
+    for (const auto& description : kits)
+    {
+        auto kit = createKit (description);
+
+        if (kit == nullptr || ! installKit (description.program, kit))
+            return juce::Result::fail ("Could not load kit \"" + description.name + "\" from " + file.getFullPathName());
+    }
+
+    return juce::Result::ok();
+}
+
+void SimpleSamplerAudioProcessor::loadKitFileAsync (const juce::File& file)
+{
+    ++numPendingLoads;
+    const auto program = getCurrentProgram();
+
+    if (loadingPool == nullptr)
+        loadingPool = std::make_unique<juce::ThreadPool> (1);
+
+    loadingPool->addJob ([this, file, program]
+    {
+        FinishedLoad load;
+        juce::Array<KitDescription> kits;
+
+        // An unreadable file finishes with no kits, which counts as a failed load
+        if (readKitFile (file, program, kits).wasOk())
+            for (const auto& description : kits)
+                load.kits.push_back ({ description.program, createKit (description) });
+
+        {
+            const juce::ScopedLock sl (pendingLoadLock);
+            finishedLoads.push_back (std::move (load));
+        }
+
+        triggerAsyncUpdate();
+    });
+}
+
+void SimpleSamplerAudioProcessor::handleAsyncUpdate()
+{
+    applyOversamplingChoice();
+    applyRenderCacheChoice();
+
+    std::vector<FinishedLoad> loads;
+
+    {
+        const juce::ScopedLock sl (pendingLoadLock);
+        std::swap (loads, finishedLoads);
+    }
+
+    if (loads.empty())
+        return;
+
+    for (auto& load : loads)
+    {
+        auto failed = load.kits.empty();
+
+        for (auto& [program, kit] : load.kits)
+            if (kit == nullptr || ! installKit (program, kit))
+                failed = true;
+
+        lastLoadFailed = failed;
+    }
+
+    numPendingLoads -= (int) loads.size();
+}
+
+bool SimpleSamplerAudioProcessor::addSampleZone (const juce::File& file, const SampleZone& zone)
+{
+    auto sampleData = decodeSample (file);
+
+    if (sampleData == nullptr)
         return false;
 
-    // Try to create a reader for this file
-    std::unique_ptr<juce::AudioFormatReader> reader (formatManager.createReaderFor (file));
+    // Published kits never change, so the zone goes into a copy of the current one
+    const auto program = getCurrentProgram();
+    SamplerKit::Ptr kit = new SamplerKit (file.getFileName());
+    KitDescription description { program, file.getFileName(), {} };
 
-    if (reader.get() != nullptr)
+    if (auto* currentKit = programBank.getKit (program))
     {
-        // Clear existing sounds
-        synth.clearSounds();
-
-        // Create a BigInteger to represent which MIDI notes should trigger this sound
-        // Setting all bits to 1 means any MIDI note will trigger the sample
-        juce::BigInteger allNotes;
-        allNotes.setRange (0, 128, true);
-
-        // Add the new sample sound
-        // Parameters: name, reader, notes, root note (C4 = 60), attack, release, max length
-        synth.addSound (new SamplerSound ("Sample",
-                                          *reader,
-                                          allNotes,
-                                          60,           // Middle C as root note
-                                          0.01,         // 10ms attack
-                                          0.1,          // 100ms release
-                                          10.0));       // Max 10 seconds
-
-        // Store the filename
-        loadedFileName = file.getFileName();
-
-        return true;
+        kit->setName (currentKit->getName());
+        description = readKitState (currentKit->getDescription());
+        description.name = currentKit->getName();
+
+        for (auto* sound : currentKit->getSounds())
+            if (auto* samplerSound = dynamic_cast<SamplerSound*> (sound))
+                kit->addSound (samplerSound->createCopy());
     }
 
-    return false;
+    kit->addSound (createSound (sampleData, zone));
+
+    description.zones.add ({ file, zone });
+    kit->setDescription (createKitState (description));
+
+    return installKit (program, kit);
+}
+
+bool SimpleSamplerAudioProcessor::loadKit (int program, const juce::String& name, const juce::Array<KitZone>& zones)
+{
+    auto kit = createKit ({ program, name, zones });
+    return kit != nullptr && installKit (program, kit);
+}
+
+SamplerKit::Ptr SimpleSamplerAudioProcessor::createKit (const KitDescription& description)
+{
+    SamplerKit::Ptr kit = new SamplerKit (description.name);
+
+    for (const auto& kitZone : description.zones)
+    {
+        auto sampleData = decodeSample (kitZone.file);
+
+        if (sampleData == nullptr)
+            return nullptr;
+
+        kit->addSound (createSound (sampleData, kitZone.zone));
+    }
+
+    kit->setDescription (createKitState (description));
+    return kit;
+}
+
+//==============================================================================
+// Kit files and kit state
+juce::Result SimpleSamplerAudioProcessor::readKitFile (const juce::File& file, int currentProgram,
+                                                       juce::Array<KitDescription>& kits)
+{
+    juce::var json;
+    const auto parseResult = juce::JSON::parse (file.loadFileAsString(), json);
+
+    if (parseResult.failed())
+        return juce::Result::fail (file.getFileName() + ": " + parseResult.getErrorMessage());
+
+    const auto baseDirectory = file.getParentDirectory();
+
+    // A bank lists its kits in program order, unless a kit names its own program
+    if (const auto* programs = json["programs"].getArray())
+    {
+        for (int i = 0; i < programs->size(); ++i)
+        {
+            KitDescription description;
+            description.program = (*programs)[i].hasProperty ("program") ? (int) (*programs)[i]["program"] : i;
+
+            const auto result = readKitJson ((*programs)[i], baseDirectory, description);
+
+            if (result.failed())
+                return result;
+
+            kits.add (description);
+        }
+
+        return juce::Result::ok();
+    }
+
+    KitDescription description;
+    description.program = currentProgram;
+
+    const auto result = readKitJson (json, baseDirectory, description);
+
+    if (result.failed())
+        return result;
+
+    if (description.name.isEmpty())
+        description.name = file.getFileNameWithoutExtension();
+
+    kits.add (description);
+    return juce::Result::ok();
+}
+
+juce::Result SimpleSamplerAudioProcessor::readKitJson (const juce::var& json, const juce::File& baseDirectory,
+                                                       KitDescription& description)
+{
+    const auto* zones = json["zones"].getArray();
+
+    if (zones == nullptr || zones->isEmpty())
+        return juce::Result::fail ("Each kit needs a \"zones\" array");
+
+    if (! juce::isPositiveAndBelow (description.program, ProgramBank::maxPrograms))
+        return juce::Result::fail ("Program " + juce::String (description.program) + " is out of range");
+
+    description.name = json["name"].toString();
+
+    for (const auto& zoneJson : *zones)
+    {
+        if (zoneJson["sample"].toString().isEmpty())
+            return juce::Result::fail ("Each zone needs a \"sample\"");
+
+        KitZone kitZone;
+        kitZone.file = baseDirectory.getChildFile (zoneJson["sample"].toString());
+
+        // No note range plays across the whole keyboard; a low note alone plays just that note
+        auto& zone = kitZone.zone;
+        zone = makeFullKeyboardZone();
+
+        if (zoneJson.hasProperty ("lowNote"))
+        {
+            const auto lowNote = juce::jlimit (0, 127, (int) zoneJson["lowNote"]);
+            const auto highNote = juce::jlimit (lowNote, 127, (int) zoneJson.getProperty ("highNote", lowNote));
+
+            zone.notes.clear();
+            zone.notes.setRange (lowNote, highNote - lowNote + 1, true);
+            zone.rootNote = lowNote;
+        }
+
+        zone.rootNote = juce::jlimit (0, 127, (int) zoneJson.getProperty ("rootNote", zone.rootNote));
+        zone.outputBus = juce::jlimit (0, numAuxOutputBuses, (int) zoneJson.getProperty ("outputBus", 0));
+        zone.chokeGroup = juce::jlimit (0, SamplerSynthesiser::maxChokeGroups, (int) zoneJson.getProperty ("chokeGroup", 0));
+        zone.loopStart = juce::jmax (0, (int) zoneJson.getProperty ("loopStart", 0));
+        zone.loopEnd = juce::jmax (0, (int) zoneJson.getProperty ("loopEnd", 0));
+
+        description.zones.add (kitZone);
+    }
+
+    return juce::Result::ok();
+}
+
+juce::ValueTree SimpleSamplerAudioProcessor::createKitState (const KitDescription& description)
+{
+    juce::ValueTree kitState ("Kit");
+    kitState.setProperty ("program", description.program, nullptr);
+    kitState.setProperty ("name", description.name, nullptr);
+
+    for (const auto& kitZone : description.zones)
+    {
+        juce::ValueTree zoneState ("Zone");
+        zoneState.setProperty ("file", kitZone.file.getFullPathName(), nullptr);
+        zoneState.setProperty ("notes", kitZone.zone.notes.toString (16), nullptr);
+        zoneState.setProperty ("rootNote", kitZone.zone.rootNote, nullptr);
+        zoneState.setProperty ("outputBus", kitZone.zone.outputBus, nullptr);
+        zoneState.setProperty ("chokeGroup", kitZone.zone.chokeGroup, nullptr);
+        zoneState.setProperty ("loopStart", kitZone.zone.loopStart, nullptr);
+        zoneState.setProperty ("loopEnd", kitZone.zone.loopEnd, nullptr);
+        kitState.appendChild (zoneState, nullptr);
+    }
+
+    return kitState;
+}
+
+SimpleSamplerAudioProcessor::KitDescription SimpleSamplerAudioProcessor::readKitState (const juce::ValueTree& kitState)
+{
+    KitDescription description;
+    description.program = kitState["program"];
+    description.name = kitState["name"].toString();
+
+    for (const auto& zoneState : kitState)
+    {
+        KitZone kitZone;
+        kitZone.file = juce::File (zoneState["file"].toString());
+        kitZone.zone.notes.parseString (zoneState["notes"].toString(), 16);
+        kitZone.zone.rootNote = zoneState["rootNote"];
+        kitZone.zone.outputBus = zoneState["outputBus"];
+        kitZone.zone.chokeGroup = zoneState["chokeGroup"];
+        kitZone.zone.loopStart = zoneState["loopStart"];
+        kitZone.zone.loopEnd = zoneState["loopEnd"];
+        description.zones.add (kitZone);
+    }
+
+    return description;
+}
+
+SimpleSamplerAudioProcessor::SampleZone SimpleSamplerAudioProcessor::makeFullKeyboardZone()
+{
+    // Setting all bits to 1 means any MIDI note will trigger the sample
+    SampleZone zone;
+    zone.notes.setRange (0, 128, true);
+    zone.rootNote = 60;     // Middle C as root note
+    return zone;
+}
+
+SampleData::Ptr SimpleSamplerAudioProcessor::decodeSample (const juce::File& file)
+{
+    if (! file.existsAsFile())
+        return nullptr;
+
+    // Decoded, trimmed and analysed once, then shared by every instance using the file
+    return sampleLibrary->load (file, 10.0);     // Max 10 seconds
+}
+
+SamplerSound* SimpleSamplerAudioProcessor::createSound (SampleData::Ptr sampleData,
+                                                        const SampleZone& zone) const
+{
+    // The envelope comes from the attack/decay/sustain/release parameters
+    auto* sound = new SamplerSound (std::move (sampleData), zone.notes, zone.rootNote);
+
+    sound->outputBus = juce::jlimit (0, numAuxOutputBuses, zone.outputBus);
+    sound->chokeGroup = juce::jlimit (0, SamplerSynthesiser::maxChokeGroups, zone.chokeGroup);
+
+    // Zone loop points count from the start of the file; the stored sample starts at the trim point
+    if (zone.loopEnd > zone.loopStart)
+    {
+        const auto trimStart = sound->getSampleData().getAnalysis().trimStart;
+        sound->loopStart = juce::jlimit (0, sound->length, zone.loopStart - trimStart);
+        sound->loopEnd = juce::jlimit (0, sound->length, zone.loopEnd - trimStart);
+    }
+
+    return sound;
+}
+
+SamplerKit::Ptr SimpleSamplerAudioProcessor::createSingleSampleKit (const juce::File& file)
+{
+    auto sampleData = decodeSample (file);
+
+    if (sampleData == nullptr)
+        return nullptr;
+
+    SamplerKit::Ptr kit = new SamplerKit (file.getFileName());
+    kit->addSound (createSound (sampleData, makeFullKeyboardZone()));
+
+    KitDescription description { 0, file.getFileName(), {} };
+    description.zones.add ({ file, makeFullKeyboardZone() });
+    kit->setDescription (createKitState (description));
+
+    return kit;
+}
+
+bool SimpleSamplerAudioProcessor::installKit (int program, SamplerKit::Ptr kit)
+{
+    collectRetiredKits();
+
+    SamplerKit::Ptr replacedKit;
+
+    if (! programBank.setKit (program, kit, replacedKit))
+        return false;   // Over the memory budget
+
+    // Voices may still be playing the old kit, so it is kept alive here and freed on
+    // the message thread once they let go
+    if (replacedKit != nullptr)
+    {
+        retiredKits.push_back ({ replacedKit, audioBlockCount.load (std::memory_order_acquire) });
+        startTimer (housekeepingIntervalMs);
+
+        // Cached notes would otherwise keep the old kit's samples alive
+        renderCache.invalidate();
+    }
+
+    // The audio thread picks up the new kit at the start of its next block
+    if (program == getCurrentProgram())
+        requestedProgram = program;
+
+    updateHostDisplay (juce::AudioProcessorListener::ChangeDetails().withProgramChanged (true));
+    return true;
+}
+
+void SimpleSamplerAudioProcessor::collectRetiredKits()
+{
+    const auto blockCount = audioBlockCount.load (std::memory_order_acquire);
+
+    // The audio thread may have read a kit from its slot just before it was replaced and
+    // not yet made it active; once a full block has passed it has either done so or never
+    // will. After that, a count of one means only this list still refers to the kit.
+    retiredKits.erase (std::remove_if (retiredKits.begin(), retiredKits.end(),
+                                       [this, blockCount] (const RetiredKit& retired)
+                                       {
+                                           return blockCount - retired.retiredAtBlock >= 2
+                                               && retired.kit->getReferenceCount() == 1
+                                               && retired.kit.get() != synth.getActiveKit()
+                                               && ! retired.kit->isPlaying();
+                                       }),
+                       retiredKits.end());
+}
+
+void SimpleSamplerAudioProcessor::timerCallback()
+{
+    collectRetiredKits();
+
+    if (retiredKits.empty())
+        stopTimer();
 }
 
 //==============================================================================
 // Virtual keyboard MIDI injection
 void SimpleSamplerAudioProcessor::addNoteOn (int midiNote, float velocity)
 {
-    juce::ScopedLock lock (virtualKeyboardLock);
-
-    // Add note on message to virtual keyboard buffer
-    auto message = juce::MidiMessage::noteOn (1, midiNote, velocity);
-    virtualKeyboardMidi.addEvent (message, 0);
+    // Add note on event to virtual keyboard FIFO
+    pushKeyboardEvent (midiNote, velocity);
 }
 
 void SimpleSamplerAudioProcessor::addNoteOff (int midiNote)
 {
-    juce::ScopedLock lock (virtualKeyboardLock);
+    // Add note off event to virtual keyboard FIFO
+    pushKeyboardEvent (midiNote, 0.0f);
+}
+
+void SimpleSamplerAudioProcessor::pushKeyboardEvent (int midiNote, float velocity)
+{
+    int start1, size1, start2, size2;
+    keyboardFifo.prepareToWrite (1, start1, size1, start2, size2);
+
+    // A full FIFO drops the event rather than blocking
+    if (size1 > 0)
+        keyboardEvents[(size_t) start1] = { midiNote, velocity };
+
+    keyboardFifo.finishedWrite (size1);
+}
+
+void SimpleSamplerAudioProcessor::readKeyboardEvents()
+{
+    int start1, size1, start2, size2;
+    keyboardFifo.prepareToRead (keyboardFifo.getNumReady(), start1, size1, start2, size2);
+
+    auto addEvents = [&] (int start, int size)
+    {
+        for (int i = start; i < start + size; ++i)
+        {
+            const auto& event = keyboardEvents[(size_t) i];
+
+            // Short messages are stored inline, so building one doesn't allocate
+            const auto message = event.velocity > 0.0f ? juce::MidiMessage::noteOn (1, event.note, event.velocity)
+                                                       : juce::MidiMessage::noteOff (1, event.note);
+            addScratchMidiEvent (message.getRawData(), message.getRawDataSize(), 0);
+        }
+    };
+
+    addEvents (start1, size1);
+    addEvents (start2, size2);
+
+    keyboardFifo.finishedRead (size1 + size2);
+}
+
+void SimpleSamplerAudioProcessor::addScratchMidiEvent (const juce::uint8* data, int numBytes, int samplePosition) noexcept
+{
+    // MidiBuffer stores a timestamp and a size ahead of each message
+    constexpr int headerBytes = (int) (sizeof (juce::int32) + sizeof (juce::uint16));
+
+    // The last kilobyte only takes note-offs, so a flood of note-ons can't leave notes stuck
+    constexpr int noteOffReserveBytes = 1024;
+
+    const auto isNoteOff = numBytes >= 3 && ((data[0] & 0xf0) == 0x80 || ((data[0] & 0xf0) == 0x90 && data[2] == 0));
+    const auto limit = isNoteOff ? midiScratchBytes : midiScratchBytes - noteOffReserveBytes;
+
+    if (midiScratch.data.size() + headerBytes + numBytes > limit)
+    {
+        numDroppedMidiEvents.fetch_add (1, std::memory_order_relaxed);
+        return;
+    }
 
-    // Add note off message to virtual keyboard buffer
-    auto message = juce::MidiMessage::noteOff (1, midiNote);
-    virtualKeyboardMidi.addEvent (message, 0);
+    midiScratch.addEvent (data, numBytes, samplePosition);
 }
 
 //==============================================================================
@@ -5,11 +5,23 @@
     PluginProcessor.h - Audio Processing Engine
 
     Features:
-    - Single WAV file sample playback
+    - WAV sample playback, one sample or a kit of zones per program
     - MIDI triggered sample playback
     - Virtual keyboard MIDI injection
+    - ADSR envelope with adjustable curve
+    - Automatic 2x/4x oversampling for extreme transpositions
+    - Per-zone routing to auxiliary stereo outputs
+    - Choke groups and mono/legato/glide play modes
+    - Linear/cubic interpolation and forward looping
+    - Granular time-stretch independent of pitch
+    - Background sample loading with silence trimming, normalisation and onset index
+    - Output level meters and spectrum analyser
+    - Cache of pre-resampled one-shot notes
+    - Program bank of preloaded kits switched by MIDI or host program change
+    - JSON kit files, and kits saved with the plugin state
+    - MIDI flood coalescing with bounded sub-block splitting
     - Volume control
-    - Reverb effect
+    - Feedback delay network reverb with size, damping, pre-delay and width
 
   ==============================================================================
 */
@@ -17,177 +29,21 @@
 #pragma once
 
 #include <JuceHeader.h>
-
-//==============================================================================
-/**
- * Custom Sampler Sound - stores the audio sample data
- */
-class SamplerSound : public juce::SynthesiserSound
-{
-public:
-    SamplerSound (const juce::String& name,
-                  juce::AudioFormatReader& source,
-                  const juce::BigInteger& midiNotes,
-                  int midiNoteForNormalPitch,
-                  double attackTimeSecs,
-                  double releaseTimeSecs,
-                  double maxSampleLengthSeconds)
-        : sourceSampleRate (source.sampleRate),
-          midiNotes (midiNotes),
-          midiRootNote (midiNoteForNormalPitch)
-    {
-        if (sourceSampleRate > 0 && source.lengthInSamples > 0)
-        {
-            length = juce::jmin ((int) source.lengthInSamples,
-                                (int) (maxSampleLengthSeconds * sourceSampleRate));
-
-            data.reset (new juce::AudioBuffer<float> (juce::jmin (2, (int) source.numChannels), length + 4));
-
-            source.read (data.get(), 0, length + 4, 0, true, true);
-
-            params.attack  = static_cast<float> (attackTimeSecs);
-            params.release = static_cast<float> (releaseTimeSecs);
-        }
-    }
-
-    bool appliesToNote (int midiNoteNumber) override
-    {
-        return midiNotes[midiNoteNumber];
-    }
-
-    bool appliesToChannel (int /*midiChannel*/) override
-    {
-        return true;
-    }
-
-    juce::AudioBuffer<float>* getAudioData() const noexcept { return data.get(); }
-
-    double sourceSampleRate;
-    juce::BigInteger midiNotes;
-    int midiRootNote, length;
-
-    std::unique_ptr<juce::AudioBuffer<float>> data;
-    juce::ADSR::Parameters params;
-
-private:
-    JUCE_LEAK_DETECTOR (SamplerSound)
-};
-
-//==============================================================================
-/**
- * Custom Sampler Voice - handles playback of the sample
- */
-class SamplerVoice : public juce::SynthesiserVoice
-{
-public:
-    SamplerVoice() {}
-
-    bool canPlaySound (juce::SynthesiserSound* sound) override
-    {
-        return dynamic_cast<const SamplerSound*> (sound) != nullptr;
-    }
-
-    void startNote (int midiNoteNumber, float velocity,
-                   juce::SynthesiserSound* s, int /*currentPitchWheelPosition*/) override
-    {
-        if (auto* sound = dynamic_cast<const SamplerSound*> (s))
-        {
-            pitchRatio = std::pow (2.0, (midiNoteNumber - sound->midiRootNote) / 12.0)
-                        * sound->sourceSampleRate / getSampleRate();
-
-            sourceSamplePosition = 0.0;
-            lgain = velocity;
-            rgain = velocity;
-
-            adsr.setSampleRate (sound->sourceSampleRate);
-            adsr.setParameters (sound->params);
-
-            adsr.noteOn();
-        }
-        else
-        {
-            jassertfalse; // This should never happen!
-        }
-    }
-
-    void stopNote (float /*velocity*/, bool allowTailOff) override
-    {
-        if (allowTailOff)
-        {
-            adsr.noteOff();
-        }
-        else
-        {
-            clearCurrentNote();
-            adsr.reset();
-        }
-    }
-
-    void pitchWheelMoved (int /*newValue*/) override {}
-    void controllerMoved (int /*controllerNumber*/, int /*newValue*/) override {}
-
-    void renderNextBlock (juce::AudioBuffer<float>& outputBuffer, int startSample, int numSamples) override
-    {
-        if (auto* playingSound = static_cast<SamplerSound*> (getCurrentlyPlayingSound().get()))
-        {
-            auto& data = *playingSound->getAudioData();
-            const float* const inL = data.getReadPointer (0);
-            const float* const inR = data.getNumChannels() > 1 ? data.getReadPointer (1) : nullptr;
-
-            float* outL = outputBuffer.getWritePointer (0, startSample);
-            float* outR = outputBuffer.getNumChannels() > 1 ? outputBuffer.getWritePointer (1, startSample) : nullptr;
-
-            while (--numSamples >= 0)
-            {
-                auto pos = (int) sourceSamplePosition;
-                auto alpha = (float) (sourceSamplePosition - pos);
-                auto invAlpha = 1.0f - alpha;
-
-                // Simple linear interpolation
-                float l = (inL[pos] * invAlpha + inL[pos + 1] * alpha);
-                float r = (inR != nullptr) ? (inR[pos] * invAlpha + inR[pos + 1] * alpha) : l;
-
-                auto envelopeValue = adsr.getNextSample();
-
-                l *= lgain * envelopeValue;
-                r *= rgain * envelopeValue;
-
-                if (outR != nullptr)
-                {
-                    *outL++ += l;
-                    *outR++ += r;
-                }
-                else
-                {
-                    *outL++ += (l + r) * 0.5f;
-                }
-
-                sourceSamplePosition += pitchRatio;
-
-                if (sourceSamplePosition > playingSound->length)
-                {
-                    stopNote (0.0f, false);
-                    break;
-                }
-            }
-        }
-    }
-
-private:
-    double pitchRatio = 0.0;
-    double sourceSamplePosition = 0.0;
-    float lgain = 0.0f, rgain = 0.0f;
-
-    juce::ADSR adsr;
-
-    JUCE_LEAK_DETECTOR (SamplerVoice)
-};
+#include "SamplerSynthesiser.h"
+#include "RealtimeArena.h"
+#include "RealtimeCheck.h"
+#include "OutputAnalyser.h"
+#include "MidiEventCoalescer.h"
+#include "FdnReverb.h"
 
 //==============================================================================
 /**
  * Main Audio Processor - handles all audio and MIDI processing
  */
-class SimpleSamplerAudioProcessor : public juce::AudioProcessor
+class SimpleSamplerAudioProcessor : public juce::AudioProcessor,
+                                    private juce::AudioProcessorValueTreeState::Listener,
+                                    private juce::Timer,
+                                    private juce::AsyncUpdater
 {
 public:
     //==============================================================================
@@ -227,38 +83,237 @@ public:
 
     //==============================================================================
     // Sample loading
+
+    /** A key range of the keyboard played by one sample. */
+    struct SampleZone
+    {
+        juce::BigInteger notes;     // MIDI notes that trigger the sample
+        int rootNote = 60;          // Note that plays the sample unpitched
+        int outputBus = 0;          // 0 = main output, 1+ = aux outputs
+        int chokeGroup = 0;         // Zones sharing a group cut each other off; 0 = none
+        int loopStart = 0;          // Loop region in samples of the file, used when Loop Mode
+        int loopEnd = 0;            // is Forward; loopEnd <= loopStart loops the whole sample
+    };
+
+    // Replaces all zones with one sample spread across the whole keyboard
     bool loadSample (const juce::File& file);
-    juce::String getLoadedFileName() const { return loadedFileName; }
+
+    // Same as loadSample, but decodes and analyses on a background thread and swaps
+    // the sample in on the message thread when it's ready
+    void loadSampleAsync (const juce::File& file);
+    bool isLoadingSample() const noexcept   { return numPendingLoads.load() > 0; }
+    bool didLastLoadFail() const noexcept   { return lastLoadFailed.load(); }
+
+    // Adds a zone alongside the existing ones, e.g. one per drum sound
+    bool addSampleZone (const juce::File& file, const SampleZone& zone);
+
+    // Name of the current program's kit; for a single loaded sample, its file name
+    juce::String getLoadedFileName() { return programBank.getProgramName (getCurrentProgram()); }
+
+    //==============================================================================
+    // Program bank (message thread). loadSample and addSampleZone act on the current
+    // program; loadKit preloads any program so switching to it later costs nothing.
+
+    /** A sample file and the zone it plays. */
+    struct KitZone
+    {
+        juce::File file;
+        SampleZone zone;
+    };
+
+    // Fails if a file can't be decoded or the kit would exceed the bank's memory budget
+    bool loadKit (int program, const juce::String& name, const juce::Array<KitZone>& zones);
+
+    /** A kit to load into a program slot, as read from a kit file or the saved state. */
+    struct KitDescription
+    {
+        int program = 0;
+        juce::String name;
+        juce::Array<KitZone> zones;
+    };
+
+    /** Reads a JSON kit file: either one kit, which goes into currentProgram, or a bank
+        of kits in a "programs" array. Sample paths are relative to the kit file. */
+    static juce::Result readKitFile (const juce::File& file, int currentProgram, juce::Array<KitDescription>& kits);
+
+    // Loads every kit in a kit file, on the calling thread or in the background
+    juce::Result loadKitFile (const juce::File& file);
+    void loadKitFileAsync (const juce::File& file);
+
+    ProgramBank& getProgramBank() noexcept { return programBank; }
 
     //==============================================================================
-    // Virtual keyboard MIDI injection
+    // Virtual keyboard MIDI injection (message thread only; lock-free towards the audio thread)
     void addNoteOn (int midiNote, float velocity);
     void addNoteOff (int midiNote);
 
+    // Events dropped because a block carried more MIDI than the audio thread has room for
+    int getNumDroppedMidiEvents() const noexcept { return numDroppedMidiEvents.load(); }
+
     //==============================================================================
     // Parameter access
     juce::AudioProcessorValueTreeState& getValueTreeState() { return parameters; }
 
+    // Output meters and spectrum; the editor starts it while open
+    OutputAnalyser& getOutputAnalyser() noexcept { return outputAnalyser; }
+
+    // Hit and miss counts for the note render cache
+    const NoteRenderCache& getRenderCache() const noexcept { return renderCache; }
+
 private:
     //==============================================================================
-    // Audio processing components
-    juce::Synthesiser synth;
-    juce::AudioFormatManager formatManager;
+    static constexpr int numAuxOutputBuses = SamplerSynthesiser::maxOutputBuses - 1;
+    static constexpr int polyphony = 8;
+
+    // Retired kits are checked this often until all have been freed
+    static constexpr int housekeepingIntervalMs = 100;
+
+    static BusesProperties createBusesProperties();
+    static juce::AudioProcessorValueTreeState::ParameterLayout createParameterLayout();
+
+    // Tells the synthesiser where each output bus sits in the process buffer
+    void updateOutputBuses();
+
+    SamplerSound* createSound (SampleData::Ptr sampleData, const SampleZone& zone) const;
+    SampleData::Ptr decodeSample (const juce::File& file);
+    static SampleZone makeFullKeyboardZone();
+
+    SamplerKit::Ptr createSingleSampleKit (const juce::File& file);
+    SamplerKit::Ptr createKit (const KitDescription& description);
+
+    // Kits as they are saved in the plugin state
+    static juce::ValueTree createKitState (const KitDescription& description);
+    static KitDescription readKitState (const juce::ValueTree& state);
+    static juce::Result readKitJson (const juce::var& json, const juce::File& baseDirectory, KitDescription& description);
+
+    // Publishes a kit into a program slot, retiring the kit it replaces
+    bool installKit (int program, SamplerKit::Ptr kit);
+    void handleAsyncUpdate() override;
+
+    // Frees replaced kits once no voice refers to them any more
+    void collectRetiredKits();
+
+    void timerCallback() override;
+
+    void pushKeyboardEvent (int midiNote, float velocity);
+    void readKeyboardEvents();
+
+    // Copies an event into midiScratch if it fits in the space reserved for it
+    void addScratchMidiEvent (const juce::uint8* data, int numBytes, int samplePosition) noexcept;
+
+    // Pushes the current envelope and play mode parameters to the synthesiser
+    void updateVoiceParameters();
+
+    // Renders the synthesiser, through the oversampler when a voice is transposed far up
+    void renderVoices (juce::AudioBuffer<float>& buffer, const juce::MidiBuffer& midiMessages);
+    void renderOversampled (juce::dsp::AudioBlock<float>& oversampledBlock, const juce::MidiBuffer& midiMessages, int factor);
+    bool needsOversampling (const juce::MidiBuffer& midiMessages);
+    void parameterChanged (const juce::String& parameterID, float newValue) override;
+    void applyOversamplingChoice();
+    void applyRenderCacheChoice();
+    int getOversamplingLatency (int choice) const;
+    void setOversamplingChoice (int newChoice);
+    void setVoiceOversamplingFactor (int factor);
+    void drainOversampler (juce::dsp::Oversampling<float>& oversampler, juce::AudioBuffer<float>& buffer);
+    void drainLatencyCompensation (juce::AudioBuffer<float>& buffer);
+
+    //==============================================================================
+    // Audio processing components; the bank and the note cache outlive the synthesiser
+    // and voices that read them
+    ProgramBank programBank;
+    NoteRenderCache renderCache;
+    SamplerSynthesiser synth;
+    bool prepared = false;      // Between prepareToPlay and releaseResources
+    juce::SharedResourcePointer<SampleLibrary> sampleLibrary;     // Also owns the process-wide format manager
+
+    // Output metering
+    OutputAnalyser outputAnalyser;
 
     // DSP processing
-    juce::dsp::ProcessorDuplicator<juce::dsp::Reverb, juce::dsp::Reverb::Parameters> reverb;
+    FdnReverb reverb;
+
+    // Oversampling (2x and 4x), used only while some voice plays above the pitch threshold.
+    // The direct path is delayed by the same latency so the reported latency never changes.
+    // A new choice is applied on the message thread, which reports its latency to the host
+    // and then hands it to the audio thread through appliedOversamplingChoice.
+    static constexpr double oversamplingPitchThreshold = 2.0;
+    std::array<std::unique_ptr<juce::dsp::Oversampling<float>>, 2> oversamplers;
+    juce::dsp::DelayLine<float, juce::dsp::DelayLineInterpolationTypes::None> latencyCompensation;
+    juce::AudioBuffer<float> oversamplingScratch;
+    juce::MidiBuffer oversampledMidi;
+    std::atomic<int> appliedOversamplingChoice { 0 };
+    int oversamplingChoice = 0;      // 0 = off, 1 = 2x, 2 = 4x; audio thread's copy
+    bool oversamplingActive = false;
 
     // Parameters
     juce::AudioProcessorValueTreeState parameters;
     std::atomic<float>* volumeParameter = nullptr;
     std::atomic<float>* reverbParameter = nullptr;
+    std::atomic<float>* reverbSizeParameter = nullptr;
+    std::atomic<float>* reverbDampingParameter = nullptr;
+    std::atomic<float>* reverbPreDelayParameter = nullptr;
+    std::atomic<float>* reverbWidthParameter = nullptr;
+    std::atomic<float>* attackParameter = nullptr;
+    std::atomic<float>* decayParameter = nullptr;
+    std::atomic<float>* sustainParameter = nullptr;
+    std::atomic<float>* releaseParameter = nullptr;
+    std::atomic<float>* curveParameter = nullptr;
+    std::atomic<float>* oversamplingParameter = nullptr;
+    std::atomic<float>* playModeParameter = nullptr;
+    std::atomic<float>* glideParameter = nullptr;
+    std::atomic<float>* interpolationParameter = nullptr;
+    std::atomic<float>* loopModeParameter = nullptr;
+    std::atomic<float>* timeStretchParameter = nullptr;
+    std::atomic<float>* stretchRateParameter = nullptr;
+    std::atomic<float>* normaliseParameter = nullptr;
+    std::atomic<float>* startOnsetParameter = nullptr;
+    std::atomic<float>* renderCacheParameter = nullptr;
+
+    // Audio thread working memory, allocated in prepareToPlay
+    RealtimeArena arena;
+    static constexpr int midiScratchBytes = 32768;
+    juce::MidiBuffer midiScratch;
+    std::atomic<int> numDroppedMidiEvents { 0 };
+    MidiEventCoalescer midiCoalescer;
+
+    // Replaced kits waiting for their last voice to finish, and for the audio thread to
+    // finish any block that might have picked one up before it was replaced
+    struct RetiredKit
+    {
+        SamplerKit::Ptr kit;
+        juce::uint32 retiredAtBlock = 0;
+    };
+
+    std::vector<RetiredKit> retiredKits;
+    std::atomic<juce::uint32> audioBlockCount { 0 };     // Bumped at the end of every processBlock
+
+    // Host program selection waiting for the audio thread; -1 = none
+    std::atomic<int> requestedProgram { -1 };
+
+    // Virtual keyboard events, single producer (message thread) to single consumer (audio thread)
+    struct KeyboardEvent
+    {
+        int note = 0;
+        float velocity = 0.0f;  // 0 = note off
+    };
+
+    std::array<KeyboardEvent, 256> keyboardEvents;
+    juce::AbstractFifo keyboardFifo { 256 };
+
+    // Background loads hand their finished kits over to the message thread here, in order
+    struct FinishedLoad
+    {
+        std::vector<std::pair<int, SamplerKit::Ptr>> kits;   // Program and kit; nullptr if it failed
+    };
 
-    // Virtual keyboard MIDI buffer
-    juce::MidiBuffer virtualKeyboardMidi;
-    juce::CriticalSection virtualKeyboardLock;
+    juce::CriticalSection pendingLoadLock;
+    std::vector<FinishedLoad> finishedLoads;
+    std::atomic<int> numPendingLoads { 0 };
+    std::atomic<bool> lastLoadFailed { false };
 
-    // Sample info
-    juce::String loadedFileName;
+    // Created by the first background load. Declared last so it is destroyed first,
+    // while its jobs can still use the rest
+    std::unique_ptr<juce::ThreadPool> loadingPool;
 
     //==============================================================================
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SimpleSamplerAudioProcessor)
@@ -0,0 +1,101 @@
+/*
+  ==============================================================================
+
+    SimpleSampler - WAV Sampler Plugin with Virtual Keyboard
+    ProgramBank.cpp - Preloaded kits selectable by program number
+
+  ==============================================================================
+*/
+
+#include "ProgramBank.h"
+
+//==============================================================================
+void SamplerKit::addSampleData (juce::Array<const SampleData*>& dataInUse) const
+{
+    for (auto* sound : sounds)
+        if (auto* samplerSound = dynamic_cast<const SamplerSound*> (sound))
+            dataInUse.addIfNotAlreadyThere (&samplerSound->getSampleData());
+}
+
+bool SamplerKit::isPlaying() const noexcept
+{
+    // The kit holds one reference to each sound; a voice playing it holds another
+    for (auto* sound : sounds)
+        if (sound->getReferenceCount() > 1)
+            return true;
+
+    return false;
+}
+
+//==============================================================================
+ProgramBank::ProgramBank()
+{
+    for (auto& slot : slots)
+        slot.store (nullptr);
+}
+
+bool ProgramBank::setKit (int program, SamplerKit::Ptr kit, SamplerKit::Ptr& replacedKit)
+{
+    if (! juce::isPositiveAndBelow (program, maxPrograms))
+        return false;
+
+    if (getMemoryUsedWith (program, kit.get()) > memoryBudgetBytes)
+        return false;
+
+    replacedKit = ownedKits[(size_t) program];
+    ownedKits[(size_t) program] = kit;
+    slots[(size_t) program].store (kit.get(), std::memory_order_release);
+
+    return true;
+}
+
+size_t ProgramBank::getMemoryUsed() const
+{
+    return getMemoryUsedWith (-1, nullptr);
+}
+
+size_t ProgramBank::getMemoryUsedWith (int program, const SamplerKit* kit) const
+{
+    // Kits often share samples, so each sample is only counted once
+    juce::Array<const SampleData*> dataInUse;
+
+    for (int i = 0; i < maxPrograms; ++i)
+    {
+        const auto* kitInSlot = i == program ? kit : ownedKits[(size_t) i].get();
+
+        if (kitInSlot != nullptr)
+            kitInSlot->addSampleData (dataInUse);
+    }
+
+    size_t total = 0;
+
+    for (auto* data : dataInUse)
+        total += data->getSizeInBytes();
+
+    return total;
+}
+
+//==============================================================================
+int ProgramBank::getNumPrograms() const noexcept
+{
+    // Up to the highest loaded program, and always at least one
+    for (int i = maxPrograms; --i > 0;)
+        if (ownedKits[(size_t) i] != nullptr)
+            return i + 1;
+
+    return 1;
+}
+
+juce::String ProgramBank::getProgramName (int program) const
+{
+    if (! juce::isPositiveAndBelow (program, maxPrograms) || ownedKits[(size_t) program] == nullptr)
+        return {};
+
+    return ownedKits[(size_t) program]->getName();
+}
+
+void ProgramBank::setProgramName (int program, const juce::String& newName)
+{
+    if (juce::isPositiveAndBelow (program, maxPrograms) && ownedKits[(size_t) program] != nullptr)
+        ownedKits[(size_t) program]->setName (newName);
+}
@@ -0,0 +1,102 @@
+/*
+  ==============================================================================
+
+    SimpleSampler - WAV Sampler Plugin with Virtual Keyboard
+    ProgramBank.h - Preloaded kits selectable by program number
+
+    A kit is a fixed set of sounds. Kits are built and decoded on the
+    message thread, then published into a program slot; the audio thread
+    switches kits by loading one pointer. Kits never change once
+    published, so a replacement kit is always a new object and the old
+    one is retired until its last voice has finished.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "SamplerVoice.h"
+
+//==============================================================================
+/**
+ * An immutable set of sounds played together, e.g. one drum kit
+ */
+class SamplerKit : public juce::ReferenceCountedObject
+{
+public:
+    using Ptr = juce::ReferenceCountedObjectPtr<SamplerKit>;
+
+    explicit SamplerKit (const juce::String& kitName) : name (kitName) {}
+
+    // Only while building, before the kit is published
+    void addSound (SamplerSound* sound)     { sounds.add (sound); }
+
+    const juce::ReferenceCountedArray<juce::SynthesiserSound>& getSounds() const noexcept { return sounds; }
+
+    const juce::String& getName() const noexcept        { return name; }
+    void setName (const juce::String& newName)          { name = newName; }
+
+    // The files and zones the kit was built from, saved with the plugin state; message thread only
+    const juce::ValueTree& getDescription() const noexcept      { return description; }
+    void setDescription (const juce::ValueTree& newDescription) { description = newDescription; }
+
+    /** Sample data used by the kit, for the bank's memory budget. */
+    void addSampleData (juce::Array<const SampleData*>& dataInUse) const;
+
+    /** True while any voice still holds one of the kit's sounds. */
+    bool isPlaying() const noexcept;
+
+private:
+    juce::String name;
+    juce::ReferenceCountedArray<juce::SynthesiserSound> sounds;
+    juce::ValueTree description;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SamplerKit)
+};
+
+//==============================================================================
+/**
+ * Program slots holding preloaded kits within a memory budget
+ */
+class ProgramBank
+{
+public:
+    static constexpr int maxPrograms = 128;
+    static constexpr size_t defaultMemoryBudgetBytes = (size_t) 512 * 1024 * 1024;
+
+    ProgramBank();
+
+    //==============================================================================
+    // Message thread
+
+    /** Publishes a kit into a program slot. Fails without changing anything if the
+        bank would go over its memory budget; otherwise the kit it replaced, if any, is
+        returned in replacedKit and must be kept alive until it stops playing. */
+    bool setKit (int program, SamplerKit::Ptr kit, SamplerKit::Ptr& replacedKit);
+
+    void setMemoryBudget (size_t newBudgetBytes) noexcept   { memoryBudgetBytes = newBudgetBytes; }
+    size_t getMemoryUsed() const;
+
+    int getNumPrograms() const noexcept;
+    juce::String getProgramName (int program) const;
+    void setProgramName (int program, const juce::String& newName);
+
+    //==============================================================================
+    /** Any thread: the kit in a program slot, or nullptr for an empty slot. */
+    SamplerKit* getKit (int program) const noexcept
+    {
+        return juce::isPositiveAndBelow (program, maxPrograms) ? slots[(size_t) program].load (std::memory_order_acquire)
+                                                               : nullptr;
+    }
+
+private:
+    size_t getMemoryUsedWith (int program, const SamplerKit* kit) const;
+
+    // The audio thread reads slots; ownedKits keeps the published kits alive
+    std::array<std::atomic<SamplerKit*>, maxPrograms> slots;
+    std::array<SamplerKit::Ptr, maxPrograms> ownedKits;
+    size_t memoryBudgetBytes = defaultMemoryBudgetBytes;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ProgramBank)
+};
@@ -0,0 +1,72 @@
+/*
+  ==============================================================================
+
+    SimpleSampler - WAV Sampler Plugin with Virtual Keyboard
+    RealtimeArena.h - Preallocated working memory for the audio thread
+
+    All scratch memory the audio thread touches is carved out of one block
+    allocated in prepareToPlay, so processing never reaches the heap.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+ * Bump allocator over a single block, sized and filled in prepareToPlay
+ */
+class RealtimeArena
+{
+public:
+    static constexpr size_t alignment = 32;
+
+    RealtimeArena() = default;
+
+    /** Bytes taken by count objects, including alignment padding. */
+    template <typename Type>
+    static constexpr size_t bytesFor (size_t count) noexcept
+    {
+        return (count * sizeof (Type) + alignment - 1) & ~(alignment - 1);
+    }
+
+    /** Replaces the block with a zeroed one of at least numBytes. Not realtime safe. */
+    void allocate (size_t numBytes)
+    {
+        storage.calloc (numBytes + alignment);
+        capacity = numBytes;
+        used = 0;
+
+        const auto address = reinterpret_cast<std::uintptr_t> (storage.get());
+        base = storage.get() + ((alignment - (address & (alignment - 1))) & (alignment - 1));
+    }
+
+    /** Hands out the next count objects; only call while preparing. */
+    template <typename Type>
+    Type* take (size_t count) noexcept
+    {
+        const auto numBytes = bytesFor<Type> (count);
+
+        if (used + numBytes > capacity)
+        {
+            jassertfalse; // The arena was sized too small in prepareToPlay
+            return nullptr;
+        }
+
+        auto* result = reinterpret_cast<Type*> (base + used);
+        used += numBytes;
+        return result;
+    }
+
+    size_t getCapacity() const noexcept  { return capacity; }
+    size_t getBytesUsed() const noexcept { return used; }
+
+private:
+    juce::HeapBlock<char> storage;
+    char* base = nullptr;
+    size_t capacity = 0, used = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (RealtimeArena)
+};
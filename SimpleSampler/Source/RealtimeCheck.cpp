@@ -0,0 +1,221 @@
+/*
+  ==============================================================================
+
+    SimpleSampler - WAV Sampler Plugin with Virtual Keyboard
+    RealtimeCheck.cpp - Debug checks for allocations and locks on the audio thread
+
+  ==============================================================================
+*/
+
+#include "RealtimeCheck.h"
+
+#if SIMPLESAMPLER_REALTIME_CHECKS
+
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+#if JUCE_WINDOWS
+ #include <malloc.h>
+#endif
+
+// In a standalone program on glibc the C allocation functions can be replaced too, and
+// glibc exports the real ones under these names. A plugin can't do this safely: it would
+// change the allocator of the host it is loaded into.
+#if JUCE_LINUX && JUCE_STANDALONE_APPLICATION && defined (__GLIBC__)
+ #define SIMPLESAMPLER_REPLACE_C_ALLOCATION 1
+
+extern "C"
+{
+    void* __libc_malloc (std::size_t);
+    void* __libc_calloc (std::size_t, std::size_t);
+    void* __libc_realloc (void*, std::size_t);
+    void  __libc_free (void*);
+}
+#else
+ #define SIMPLESAMPLER_REPLACE_C_ALLOCATION 0
+#endif
+
+namespace RealtimeCheck
+{
+    static thread_local bool isAudioThread = false;
+    static std::atomic<int> numViolations { 0 };
+
+    static void report (const char* what, const char* detail) noexcept
+    {
+        // Reporting must not itself be flagged
+        const auto wasAudioThread = isAudioThread;
+        isAudioThread = false;
+
+        ++numViolations;
+        std::fprintf (stderr, "SimpleSampler realtime violation: %s %s\n", what, detail);
+        jassertfalse;
+
+        isAudioThread = wasAudioThread;
+    }
+
+    ScopedAudioThread::ScopedAudioThread() noexcept
+        : wasAudioThread (isAudioThread)
+    {
+        isAudioThread = true;
+    }
+
+    ScopedAudioThread::~ScopedAudioThread() noexcept
+    {
+        isAudioThread = wasAudioThread;
+    }
+
+    void reportLock (const char* description) noexcept
+    {
+        if (isAudioThread)
+            report ("contended lock:", description);
+    }
+
+    int getNumViolations() noexcept
+    {
+        return numViolations.load();
+    }
+
+    //==============================================================================
+    static void checkAllocation() noexcept
+    {
+        if (isAudioThread)
+            report ("allocation on the audio thread,", "see the debugger for the call stack");
+    }
+
+    // Freeing can take the allocator's locks just as allocating can
+    static void checkDeallocation (void* p) noexcept
+    {
+        if (p != nullptr && isAudioThread)
+            report ("deallocation on the audio thread,", "see the debugger for the call stack");
+    }
+
+   #if SIMPLESAMPLER_REPLACE_C_ALLOCATION
+    static void* systemMalloc (std::size_t size) noexcept   { return __libc_malloc (size); }
+    static void systemFree (void* p) noexcept               { __libc_free (p); }
+   #else
+    static void* systemMalloc (std::size_t size) noexcept   { return std::malloc (size); }
+    static void systemFree (void* p) noexcept               { std::free (p); }
+   #endif
+
+    static void* systemAlignedMalloc (std::size_t size, std::size_t alignment) noexcept
+    {
+       #if JUCE_WINDOWS
+        return _aligned_malloc (size, alignment);
+       #else
+        void* p = nullptr;
+        return posix_memalign (&p, juce::jmax (alignment, sizeof (void*)), size) == 0 ? p : nullptr;
+       #endif
+    }
+
+    static void systemAlignedFree (void* p) noexcept
+    {
+       #if JUCE_WINDOWS
+        _aligned_free (p);
+       #else
+        systemFree (p);
+       #endif
+    }
+
+    //==============================================================================
+    static void* allocate (std::size_t size) noexcept
+    {
+        checkAllocation();
+        return systemMalloc (size == 0 ? 1 : size);
+    }
+
+    static void* allocateAligned (std::size_t size, std::align_val_t alignment) noexcept
+    {
+        checkAllocation();
+        return systemAlignedMalloc (size == 0 ? 1 : size, static_cast<std::size_t> (alignment));
+    }
+
+    static void deallocate (void* p) noexcept
+    {
+        checkDeallocation (p);
+        systemFree (p);
+    }
+
+    static void deallocateAligned (void* p) noexcept
+    {
+        checkDeallocation (p);
+        systemAlignedFree (p);
+    }
+
+    template <typename Pointer>
+    static Pointer throwIfNull (Pointer p)
+    {
+        if (p == nullptr)
+            throw std::bad_alloc();
+
+        return p;
+    }
+}
+
+//==============================================================================
+using RealtimeCheck::allocate;
+using RealtimeCheck::allocateAligned;
+using RealtimeCheck::deallocate;
+using RealtimeCheck::deallocateAligned;
+using RealtimeCheck::throwIfNull;
+
+void* operator new (std::size_t size)                                                    { return throwIfNull (allocate (size)); }
+void* operator new[] (std::size_t size)                                                  { return throwIfNull (allocate (size)); }
+void* operator new (std::size_t size, const std::nothrow_t&) noexcept                    { return allocate (size); }
+void* operator new[] (std::size_t size, const std::nothrow_t&) noexcept                  { return allocate (size); }
+void* operator new (std::size_t size, std::align_val_t a)                                { return throwIfNull (allocateAligned (size, a)); }
+void* operator new[] (std::size_t size, std::align_val_t a)                              { return throwIfNull (allocateAligned (size, a)); }
+void* operator new (std::size_t size, std::align_val_t a, const std::nothrow_t&) noexcept    { return allocateAligned (size, a); }
+void* operator new[] (std::size_t size, std::align_val_t a, const std::nothrow_t&) noexcept  { return allocateAligned (size, a); }
+
+void operator delete (void* p) noexcept                                                  { deallocate (p); }
+void operator delete[] (void* p) noexcept                                                { deallocate (p); }
+void operator delete (void* p, std::size_t) noexcept                                     { deallocate (p); }
+void operator delete[] (void* p, std::size_t) noexcept                                   { deallocate (p); }
+void operator delete (void* p, const std::nothrow_t&) noexcept                           { deallocate (p); }
+void operator delete[] (void* p, const std::nothrow_t&) noexcept                         { deallocate (p); }
+void operator delete (void* p, std::align_val_t) noexcept                                { deallocateAligned (p); }
+void operator delete[] (void* p, std::align_val_t) noexcept                              { deallocateAligned (p); }
+void operator delete (void* p, std::size_t, std::align_val_t) noexcept                   { deallocateAligned (p); }
+void operator delete[] (void* p, std::size_t, std::align_val_t) noexcept                 { deallocateAligned (p); }
+void operator delete (void* p, std::align_val_t, const std::nothrow_t&) noexcept         { deallocateAligned (p); }
+void operator delete[] (void* p, std::align_val_t, const std::nothrow_t&) noexcept       { deallocateAligned (p); }
+
+#if SIMPLESAMPLER_REPLACE_C_ALLOCATION
+extern "C"
+{
+    void* malloc (std::size_t size) noexcept
+    {
+        RealtimeCheck::checkAllocation();
+        return __libc_malloc (size);
+    }
+
+    void* calloc (std::size_t count, std::size_t size) noexcept
+    {
+        RealtimeCheck::checkAllocation();
+        return __libc_calloc (count, size);
+    }
+
+    void* realloc (void* p, std::size_t size) noexcept
+    {
+        RealtimeCheck::checkAllocation();
+        return __libc_realloc (p, size);
+    }
+
+    void free (void* p) noexcept
+    {
+        RealtimeCheck::checkDeallocation (p);
+        __libc_free (p);
+    }
+}
+#endif
+
+#else
+
+namespace RealtimeCheck
+{
+    void reportLock (const char*) noexcept {}
+    int getNumViolations() noexcept { return 0; }
+}
+
+#endif
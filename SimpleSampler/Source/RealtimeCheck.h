@@ -0,0 +1,71 @@
+/*
+  ==============================================================================
+
+    SimpleSampler - WAV Sampler Plugin with Virtual Keyboard
+    RealtimeCheck.h - Debug checks for allocations and locks on the audio thread
+
+    Build with -DSIMPLESAMPLER_REALTIME_CHECKS=ON to replace every global
+    operator new and delete, including the aligned and nothrow forms, and
+    on Linux the C allocation functions as well, which is what JUCE's
+    HeapBlock and AudioBuffer use. Any allocation or deallocation made
+    while a ScopedAudioThread is alive, or any lock the audio thread finds
+    held through a ScopedCheckedLock, is printed to stderr and counted. In
+    normal builds everything here compiles away.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+namespace RealtimeCheck
+{
+    /** Marks the calling thread as the audio thread while in scope. */
+    struct ScopedAudioThread
+    {
+       #if SIMPLESAMPLER_REALTIME_CHECKS
+        ScopedAudioThread() noexcept;
+        ~ScopedAudioThread() noexcept;
+
+       private:
+        bool wasAudioThread;
+       #else
+        ScopedAudioThread() noexcept {}
+       #endif
+    };
+
+    /** Flags a lock that would have blocked the audio thread. */
+    void reportLock (const char* description) noexcept;
+
+    /** Holds a lock for the whole of its scope, flagging it if another thread had it
+        when the audio thread arrived. Re-entering a CriticalSection on the same thread
+        never blocks, so code inside the scope that takes the same lock is covered too,
+        rather than only the instant the lock was tested. */
+    struct ScopedCheckedLock
+    {
+       #if SIMPLESAMPLER_REALTIME_CHECKS
+        ScopedCheckedLock (const juce::CriticalSection& lockToHold, const char* description) noexcept
+            : lock (lockToHold)
+        {
+            if (! lock.tryEnter())
+            {
+                reportLock (description);
+                lock.enter();
+            }
+        }
+
+        ~ScopedCheckedLock() noexcept     { lock.exit(); }
+
+       private:
+        const juce::CriticalSection& lock;
+       #else
+        ScopedCheckedLock (const juce::CriticalSection&, const char*) noexcept {}
+       #endif
+
+        JUCE_DECLARE_NON_COPYABLE (ScopedCheckedLock)
+    };
+
+    /** Number of allocations, deallocations and contended locks flagged so far. */
+    int getNumViolations() noexcept;
+}
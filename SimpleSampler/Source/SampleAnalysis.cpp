@@ -0,0 +1,143 @@
+/*
+  ==============================================================================
+
+    SimpleSampler - WAV Sampler Plugin with Virtual Keyboard
+    SampleAnalysis.cpp - Load-time sample analysis
+
+  ==============================================================================
+*/
+
+#include "SampleAnalysis.h"
+
+//==============================================================================
+float SampleAnalysis::getNormalisationGain() const noexcept
+{
+    if (peak <= silenceThreshold)
+        return 1.0f;
+
+    const auto peakGain = juce::Decibels::decibelsToGain (-1.0f) / peak;
+    const auto rmsGain = rms > 0.0f ? juce::Decibels::decibelsToGain (-12.0f) / rms : peakGain;
+
+    // Boost towards the peak target but no further than the RMS target, never cut
+    // more than the peak needs, and never more than +24 dB
+    return juce::jmin (peakGain, juce::jmax (rmsGain, juce::jmin (1.0f, peakGain)), 16.0f);
+}
+
+int SampleAnalysis::getOnsetPosition (int index) const noexcept
+{
+    if (onsets.isEmpty() || index <= 0)
+        return 0;
+
+    return onsets[juce::jmin (index, onsets.size() - 1)];
+}
+
+int SampleAnalysis::findOnsetBefore (int position) const noexcept
+{
+    // onsets is sorted, so this is a binary search for the last one <= position
+    const auto* first = onsets.begin();
+    const auto* found = std::upper_bound (first, onsets.end(), position);
+
+    return juce::jmax (0, (int) (found - first) - 1);
+}
+
+//==============================================================================
+SampleAnalysis SampleAnalysis::analyse (const juce::AudioBuffer<float>& audio, int numSamples, double sampleRate)
+{
+    SampleAnalysis result;
+    numSamples = juce::jmin (numSamples, audio.getNumSamples());
+
+    if (numSamples <= 0 || sampleRate <= 0.0)
+        return result;
+
+    const auto numChannels = audio.getNumChannels();
+
+    auto isAudible = [&] (int i)
+    {
+        for (int ch = 0; ch < numChannels; ++ch)
+            if (std::abs (audio.getSample (ch, i)) > silenceThreshold)
+                return true;
+
+        return false;
+    };
+
+    // Trim points, keeping a little lead-in so soft attacks aren't clipped and a
+    // short tail so the decay below the threshold still fades naturally
+    int firstAudible = 0;
+
+    while (firstAudible < numSamples && ! isAudible (firstAudible))
+        ++firstAudible;
+
+    if (firstAudible == numSamples)
+        return result;  // Silent throughout
+
+    int lastAudible = numSamples - 1;
+
+    while (lastAudible > firstAudible && ! isAudible (lastAudible))
+        --lastAudible;
+
+    result.trimStart = juce::jmax (0, firstAudible - (int) (0.001 * sampleRate));
+    result.trimEnd = juce::jmin (numSamples, lastAudible + 1 + (int) (0.01 * sampleRate));
+
+    const auto length = result.getTrimmedLength();
+
+    // Levels
+    double sumOfSquares = 0.0;
+
+    for (int ch = 0; ch < numChannels; ++ch)
+    {
+        const auto range = juce::FloatVectorOperations::findMinAndMax (audio.getReadPointer (ch, result.trimStart), length);
+        result.peak = juce::jmax (result.peak, std::abs (range.getStart()), std::abs (range.getEnd()));
+
+        const auto* data = audio.getReadPointer (ch, result.trimStart);
+
+        for (int i = 0; i < length; ++i)
+            sumOfSquares += (double) data[i] * data[i];
+    }
+
+    result.rms = (float) std::sqrt (sumOfSquares / ((double) length * numChannels));
+
+    // Onsets: frames whose energy jumps well above the recent average
+    constexpr int frameSize = 512;
+    constexpr int historyFrames = 8;
+    constexpr float onsetRatio = 4.0f;  // +6 dB over the recent average
+    const auto minimumGap = (int) (0.05 * sampleRate);
+
+    result.onsets.add (0);
+
+    std::array<float, historyFrames> history {};
+    int numHistory = 0;
+
+    for (int frameStart = 0; frameStart + frameSize <= length; frameStart += frameSize)
+    {
+        float energy = 0.0f;
+
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            const auto* data = audio.getReadPointer (ch, result.trimStart + frameStart);
+
+            for (int i = 0; i < frameSize; ++i)
+                energy += data[i] * data[i];
+        }
+
+        energy /= (float) (frameSize * numChannels);
+
+        if (numHistory > 0)
+        {
+            float average = 0.0f;
+
+            for (int i = 0; i < numHistory; ++i)
+                average += history[(size_t) i];
+
+            average /= (float) numHistory;
+
+            const auto loudEnough = energy > silenceThreshold * silenceThreshold;
+
+            if (loudEnough && energy > average * onsetRatio && frameStart - result.onsets.getLast() >= minimumGap)
+                result.onsets.add (frameStart);
+        }
+
+        history[(size_t) (numHistory < historyFrames ? numHistory++ : (frameStart / frameSize) % historyFrames)] = energy;
+    }
+
+    return result;
+}
@@ -0,0 +1,48 @@
+/*
+  ==============================================================================
+
+    SimpleSampler - WAV Sampler Plugin with Virtual Keyboard
+    SampleAnalysis.h - Load-time sample analysis
+
+    Run once when a sample is decoded: finds where the audible part starts
+    and ends, measures peak and RMS level for normalisation, and indexes
+    onsets so playback can start from a transient without searching.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+ * Trim points, levels and onsets of a decoded sample
+ */
+struct SampleAnalysis
+{
+    int trimStart = 0;          // First sample kept, in the decoded clip
+    int trimEnd = 0;            // One past the last sample kept
+    float peak = 0.0f;          // Of the trimmed sample, across channels
+    float rms = 0.0f;
+    juce::Array<int> onsets;    // Ascending, relative to trimStart; the first is always 0
+
+    int getTrimmedLength() const noexcept { return trimEnd - trimStart; }
+
+    /** Gain that brings the peak to -1 dBFS, held back so quiet, dense material
+        doesn't end up louder than -12 dBFS RMS. */
+    float getNormalisationGain() const noexcept;
+
+    /** Start position of the given onset, or of the last one if there are fewer. */
+    int getOnsetPosition (int index) const noexcept;
+
+    /** Index of the last onset at or before the given position. */
+    int findOnsetBefore (int position) const noexcept;
+
+    //==============================================================================
+    /** Analyses the first numSamples of a decoded clip. */
+    static SampleAnalysis analyse (const juce::AudioBuffer<float>& audio, int numSamples, double sampleRate);
+
+    // Anything quieter than this at either end is trimmed (-60 dBFS)
+    static constexpr float silenceThreshold = 0.001f;
+};
@@ -0,0 +1,133 @@
+/*
+  ==============================================================================
+
+    SimpleSampler - WAV Sampler Plugin with Virtual Keyboard
+    SampleLibrary.cpp - Decoded, trimmed and analysed sample cache
+
+  ==============================================================================
+*/
+
+#include "SampleLibrary.h"
+
+//==============================================================================
+SampleData::SampleData (const juce::String& sampleName, double rate, const juce::AudioBuffer<float>& decoded,
+                        const SampleAnalysis& sampleAnalysis)
+    : name (sampleName),
+      sampleRate (rate),
+      length (sampleAnalysis.getTrimmedLength()),
+      audio (decoded.getNumChannels(), sampleAnalysis.getTrimmedLength() + guardSamples),
+      analysis (sampleAnalysis)
+{
+    // Only the audible part is kept, which is what saves the memory
+    for (int ch = 0; ch < audio.getNumChannels(); ++ch)
+        audio.copyFrom (ch, 0, decoded, ch, analysis.trimStart, length);
+
+    audio.clear (length, guardSamples);
+}
+
+//==============================================================================
+SampleLibrary::SampleLibrary()
+{
+    formatManager.registerBasicFormats();
+}
+
+SampleData::Ptr SampleLibrary::load (const juce::File& file, double maxLengthSeconds)
+{
+    const auto key = makeKey (file, maxLengthSeconds);
+
+    if (auto cached = find (key))
+        return cached;
+
+    // Decoding and analysis run outside the lock, so other loads aren't held up
+    auto data = decode (file, maxLengthSeconds);
+
+    if (data == nullptr)
+        return nullptr;
+
+    const juce::ScopedLock sl (lock);
+
+    // Another thread may have loaded the same file meanwhile
+    for (auto& entry : entries)
+        if (entry.key == key)
+            return entry.data;
+
+    entries.push_back ({ key, data, ++useCounter });
+    trimUnused();
+
+    return data;
+}
+
+juce::String SampleLibrary::makeKey (const juce::File& file, double maxLengthSeconds)
+{
+    // A changed file gets a new key, so stale audio is never served
+    return file.getFullPathName()
+         + "|" + juce::String (file.getLastModificationTime().toMilliseconds())
+         + "|" + juce::String (file.getSize())
+         + "|" + juce::String (maxLengthSeconds);
+}
+
+SampleData::Ptr SampleLibrary::decode (const juce::File& file, double maxLengthSeconds)
+{
+    std::unique_ptr<juce::AudioFormatReader> reader (formatManager.createReaderFor (file));
+
+    if (reader == nullptr || reader->sampleRate <= 0 || reader->lengthInSamples <= 0)
+        return nullptr;
+
+    const auto numSamples = (int) juce::jmin (reader->lengthInSamples,
+                                              (juce::int64) (maxLengthSeconds * reader->sampleRate));
+
+    juce::AudioBuffer<float> decoded (juce::jmin (2, (int) reader->numChannels), numSamples);
+    reader->read (&decoded, 0, numSamples, 0, true, true);
+
+    const auto analysis = SampleAnalysis::analyse (decoded, numSamples, reader->sampleRate);
+
+    // Nothing above the silence threshold leaves nothing to play, which counts as a failed load
+    if (analysis.getTrimmedLength() <= 0)
+        return nullptr;
+
+    return new SampleData (file.getFileName(), reader->sampleRate, decoded, analysis);
+}
+
+SampleData::Ptr SampleLibrary::find (const juce::String& key)
+{
+    const juce::ScopedLock sl (lock);
+
+    for (auto& entry : entries)
+    {
+        if (entry.key == key)
+        {
+            entry.lastUsed = ++useCounter;
+            return entry.data;
+        }
+    }
+
+    return nullptr;
+}
+
+void SampleLibrary::trimUnused()
+{
+    // Only the cache refers to an entry with a count of one
+    auto isUnused = [] (const Entry& entry) { return entry.data->getReferenceCount() == 1; };
+
+    for (;;)
+    {
+        size_t unusedBytes = 0;
+        Entry* oldest = nullptr;
+
+        for (auto& entry : entries)
+        {
+            if (isUnused (entry))
+            {
+                unusedBytes += entry.data->getSizeInBytes();
+
+                if (oldest == nullptr || entry.lastUsed < oldest->lastUsed)
+                    oldest = &entry;
+            }
+        }
+
+        if (unusedBytes <= unusedBudgetBytes || oldest == nullptr)
+            return;
+
+        entries.erase (entries.begin() + (oldest - entries.data()));
+    }
+}
@@ -0,0 +1,95 @@
+/*
+  ==============================================================================
+
+    SimpleSampler - WAV Sampler Plugin with Virtual Keyboard
+    SampleLibrary.h - Decoded, trimmed and analysed sample cache
+
+    Samples are decoded once, analysed, and stored trimmed to their
+    audible part. The result is shared by every sound and every plugin
+    instance that uses the same file, and kept for a while after its last
+    user lets go so reloading a sample skips the work.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "SampleAnalysis.h"
+
+//==============================================================================
+/**
+ * Decoded sample audio with its analysis
+ */
+class SampleData : public juce::ReferenceCountedObject
+{
+public:
+    using Ptr = juce::ReferenceCountedObjectPtr<SampleData>;
+
+    // Number of zeroed samples after the end, so interpolation can read past it
+    static constexpr int guardSamples = 4;
+
+    SampleData (const juce::String& name, double sampleRate, const juce::AudioBuffer<float>& decoded,
+                const SampleAnalysis& analysis);
+
+    const juce::String& getName() const noexcept                { return name; }
+    double getSampleRate() const noexcept                       { return sampleRate; }
+    int getLength() const noexcept                              { return length; }
+    const juce::AudioBuffer<float>& getAudio() const noexcept   { return audio; }
+    const SampleAnalysis& getAnalysis() const noexcept          { return analysis; }
+
+    size_t getSizeInBytes() const noexcept
+    {
+        return (size_t) audio.getNumChannels() * (size_t) audio.getNumSamples() * sizeof (float);
+    }
+
+private:
+    juce::String name;
+    double sampleRate;
+    int length;
+    juce::AudioBuffer<float> audio;     // Trimmed, length + guardSamples long
+    SampleAnalysis analysis;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SampleData)
+};
+
+//==============================================================================
+/**
+ * Process-wide cache of decoded samples, safe to use from any thread
+ */
+class SampleLibrary
+{
+public:
+    SampleLibrary();
+
+    /** Returns the decoded sample, from the cache if the file hasn't changed since it
+        was last loaded, or nullptr if it can't be read or is silent throughout.
+        Decoding happens on the calling thread. */
+    SampleData::Ptr load (const juce::File& file, double maxLengthSeconds);
+
+    // Unused samples are kept up to this many bytes before the oldest are dropped
+    static constexpr size_t unusedBudgetBytes = 256 * 1024 * 1024;
+
+private:
+    struct Entry
+    {
+        juce::String key;
+        SampleData::Ptr data;
+        juce::uint32 lastUsed = 0;
+    };
+
+    static juce::String makeKey (const juce::File& file, double maxLengthSeconds);
+    SampleData::Ptr decode (const juce::File& file, double maxLengthSeconds);
+
+    SampleData::Ptr find (const juce::String& key);
+    void trimUnused();
+
+    // Registered once per process rather than once per plugin instance; only read after that
+    juce::AudioFormatManager formatManager;
+
+    juce::CriticalSection lock;
+    std::vector<Entry> entries;
+    juce::uint32 useCounter = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SampleLibrary)
+};
@@ -0,0 +1,405 @@
+/*
+  ==============================================================================
+
+    SimpleSampler - WAV Sampler Plugin with Virtual Keyboard
+    SamplerSynthesiser.cpp - Voice management and output routing
+
+  ==============================================================================
+*/
+
+#include "SamplerSynthesiser.h"
+
+//==============================================================================
+SamplerVoice* SamplerSynthesiser::addSamplerVoice (SamplerVoice* newVoice)
+{
+    const juce::ScopedLock sl (lock);
+
+    addVoice (newVoice);
+    rebuildVoiceIndex();
+
+    return newVoice;
+}
+
+void SamplerSynthesiser::setOutputBuses (const std::array<OutputBus, maxOutputBuses>& newBuses, int newNumBuses)
+{
+    const juce::ScopedLock sl (lock);
+
+    outputBuses = newBuses;
+    numOutputBuses = juce::jlimit (0, maxOutputBuses, newNumBuses);
+}
+
+void SamplerSynthesiser::setPlayMode (PlayMode newMode) noexcept
+{
+    if (playMode != newMode)
+    {
+        playMode = newMode;
+        monoVoice = nullptr;
+        numHeldNotes = 0;
+    }
+}
+
+//==============================================================================
+void SamplerSynthesiser::noteOn (int midiChannel, int midiNoteNumber, float velocity)
+{
+    const juce::ScopedLock sl (lock);
+
+    int glideFromNote = -1;
+
+    if (playMode != PlayMode::poly)
+    {
+        pushHeldNote (midiNoteNumber);
+
+        if (monoVoice != nullptr)
+        {
+            // Legato: another key is still down, so slide the sounding voice without retriggering
+            if (playMode == PlayMode::legato && numHeldNotes > 1 && ! monoVoice->isReleasing())
+            {
+                moveVoiceToNote (*monoVoice, midiNoteNumber);
+                monoVoice->setKeyHeld (true);
+                monoVoice->glideTo (midiNoteNumber, glideSeconds);
+                return;
+            }
+
+            if (glideSeconds > 0.0)
+                glideFromNote = voicesByNote.getList (monoVoice->getSlot());
+
+            monoVoice->choke();
+            monoVoice = nullptr;
+        }
+    }
+
+    for (auto* sound : getActiveSounds())
+    {
+        if (! sound->appliesToNote (midiNoteNumber) || ! sound->appliesToChannel (midiChannel))
+            continue;
+
+        // If hitting a note that's still ringing, release it first
+        for (int slot = voicesByNote.first (midiNoteNumber); slot >= 0;)
+        {
+            auto* voice = samplerVoices[(size_t) slot];
+            slot = voicesByNote.next (slot);
+
+            if (voice->isPlayingChannel (midiChannel))
+                stopVoice (voice, 1.0f, true);
+        }
+
+        if (auto* samplerSound = dynamic_cast<SamplerSound*> (sound))
+            if (samplerSound->chokeGroup > 0)
+                chokeGroup (samplerSound->chokeGroup);
+
+        if (auto* voice = obtainVoice())
+        {
+            startVoice (voice, sound, midiChannel, midiNoteNumber, velocity);
+            registerVoice (*voice, midiNoteNumber);
+            voice->setKeyHeld (true);
+
+            if (playMode != PlayMode::poly)
+            {
+                if (glideFromNote >= 0)
+                    voice->glideFrom (glideFromNote, glideSeconds);
+
+                monoVoice = voice;
+            }
+        }
+    }
+}
+
+void SamplerSynthesiser::noteOff (int midiChannel, int midiNoteNumber, float velocity, bool allowTailOff)
+{
+    const juce::ScopedLock sl (lock);
+
+    if (playMode != PlayMode::poly)
+    {
+        removeHeldNote (midiNoteNumber);
+
+        // Releasing the mono voice's note falls back to the most recent key still held
+        if (monoVoice != nullptr
+             && numHeldNotes > 0
+             && monoVoice->isPlayingChannel (midiChannel)
+             && voicesByNote.getList (monoVoice->getSlot()) == midiNoteNumber)
+        {
+            const auto previousNote = heldNotes[(size_t) numHeldNotes - 1];
+
+            moveVoiceToNote (*monoVoice, previousNote);
+            monoVoice->glideTo (previousNote, glideSeconds);
+            return;
+        }
+    }
+
+    for (int slot = voicesByNote.first (midiNoteNumber); slot >= 0;)
+    {
+        auto* voice = samplerVoices[(size_t) slot];
+        slot = voicesByNote.next (slot);
+
+        if (voice->isKeyHeld() && voice->isPlayingChannel (midiChannel))
+        {
+            voice->setKeyHeld (false);
+
+            if (! sustainedChannels[midiChannel] && ! voice->isSostenutoHeld())
+                stopVoice (voice, velocity, allowTailOff);
+        }
+    }
+}
+
+void SamplerSynthesiser::allNotesOff (int midiChannel, bool allowTailOff)
+{
+    const juce::ScopedLock sl (lock);
+
+    juce::Synthesiser::allNotesOff (midiChannel, allowTailOff);
+
+    for (auto* voice : samplerVoices)
+    {
+        if (midiChannel <= 0 || voice->isPlayingChannel (midiChannel))
+        {
+            voice->setKeyHeld (false);
+            voice->setSostenutoHeld (false);
+        }
+    }
+
+    sustainedChannels.clear();
+    monoVoice = nullptr;
+    numHeldNotes = 0;
+}
+
+void SamplerSynthesiser::handleSustainPedal (int midiChannel, bool isDown)
+{
+    jassert (midiChannel > 0 && midiChannel <= 16);
+    const juce::ScopedLock sl (lock);
+
+    if (isDown)
+    {
+        sustainedChannels.setBit (midiChannel);
+        return;
+    }
+
+    sustainedChannels.clearBit (midiChannel);
+
+    for (auto* voice : samplerVoices)
+        if (voice->isVoiceActive() && voice->isPlayingChannel (midiChannel)
+             && ! voice->isKeyHeld() && ! voice->isSostenutoHeld())
+            stopVoice (voice, 1.0f, true);
+}
+
+void SamplerSynthesiser::handleSostenutoPedal (int midiChannel, bool isDown)
+{
+    jassert (midiChannel > 0 && midiChannel <= 16);
+    const juce::ScopedLock sl (lock);
+
+    for (auto* voice : samplerVoices)
+    {
+        if (! voice->isVoiceActive() || ! voice->isPlayingChannel (midiChannel))
+            continue;
+
+        if (isDown)
+        {
+            if (voice->isKeyHeld())
+                voice->setSostenutoHeld (true);
+        }
+        else if (voice->isSostenutoHeld())
+        {
+            voice->setSostenutoHeld (false);
+
+            if (! voice->isKeyHeld() && ! sustainedChannels[midiChannel])
+                stopVoice (voice, 1.0f, true);
+        }
+    }
+}
+
+void SamplerSynthesiser::handleProgramChange (int /*midiChannel*/, int programNumber)
+{
+    selectProgram (programNumber);
+}
+
+void SamplerSynthesiser::selectProgram (int program) noexcept
+{
+    // Empty slots are ignored so a stray program change doesn't silence the instrument
+    auto* kit = bank != nullptr ? bank->getKit (program) : nullptr;
+
+    if (kit == nullptr)
+        return;
+
+    activeKit.store (kit, std::memory_order_release);
+    currentProgram.store (program);
+}
+
+//==============================================================================
+void SamplerSynthesiser::renderVoices (juce::AudioBuffer<float>& outputAudio, int startSample, int numSamples)
+{
+    // No layout set: everything goes to the buffer as-is
+    if (numOutputBuses == 0)
+    {
+        juce::Synthesiser::renderVoices (outputAudio, startSample, numSamples);
+        return;
+    }
+
+    // Reference each bus's channels in place, so voices write directly to their bus
+    auto* const* channels = outputAudio.getArrayOfWritePointers();
+
+    for (int bus = 0; bus < numOutputBuses; ++bus)
+    {
+        const auto& layout = outputBuses[(size_t) bus];
+
+        busAvailable[(size_t) bus] = layout.numChannels > 0
+                                  && layout.firstChannel + layout.numChannels <= outputAudio.getNumChannels();
+
+        if (busAvailable[(size_t) bus])
+            busViews[(size_t) bus].setDataToReferTo (const_cast<float**> (channels + layout.firstChannel),
+                                                     layout.numChannels,
+                                                     outputAudio.getNumSamples());
+    }
+
+    auto& mainBus = busAvailable[0] ? busViews[0] : outputAudio;
+
+    for (auto* voice : voices)
+    {
+        if (! voice->isVoiceActive())
+            continue;
+
+        auto* target = &mainBus;
+
+        // Voices routed to a disabled or missing bus fall back to the main output
+        if (auto* samplerVoice = dynamic_cast<SamplerVoice*> (voice))
+        {
+            const auto bus = samplerVoice->getOutputBus();
+
+            if (bus > 0 && bus < numOutputBuses && busAvailable[(size_t) bus])
+                target = &busViews[(size_t) bus];
+        }
+
+        voice->renderNextBlock (*target, startSample, numSamples);
+    }
+}
+
+//==============================================================================
+void SamplerSynthesiser::voiceFinished (SamplerVoice& voice)
+{
+    const auto slot = voice.getSlot();
+
+    if (slot < 0)
+        return;
+
+    voicesByNote.remove (slot);
+    voicesByGroup.remove (slot);
+    freeVoices.insert (0, slot);
+
+    voice.setKeyHeld (false);
+    voice.setSostenutoHeld (false);
+
+    if (&voice == monoVoice)
+        monoVoice = nullptr;
+}
+
+void SamplerSynthesiser::rebuildVoiceIndex()
+{
+    samplerVoices.clear();
+
+    for (auto* voice : voices)
+        if (auto* samplerVoice = dynamic_cast<SamplerVoice*> (voice))
+            samplerVoices.push_back (samplerVoice);
+
+    const auto numSlots = (int) samplerVoices.size();
+
+    voicesByNote.reset (128, numSlots);
+    voicesByGroup.reset (maxChokeGroups + 1, numSlots);
+    freeVoices.reset (1, numSlots);
+
+    for (int slot = 0; slot < numSlots; ++slot)
+    {
+        auto& voice = *samplerVoices[(size_t) slot];
+        voice.setListener (this, slot);
+
+        if (voice.isVoiceActive())
+            registerVoice (voice, voice.getCurrentlyPlayingNote());
+        else
+            freeVoices.insert (0, slot);
+    }
+}
+
+void SamplerSynthesiser::registerVoice (SamplerVoice& voice, int midiNoteNumber)
+{
+    const auto slot = voice.getSlot();
+
+    if (slot < 0)
+        return;
+
+    freeVoices.remove (slot);
+    voicesByNote.insert (juce::jlimit (0, 127, midiNoteNumber), slot);
+
+    const auto group = voice.getChokeGroup();
+
+    if (group > 0 && group <= maxChokeGroups)
+        voicesByGroup.insert (group, slot);
+    else
+        voicesByGroup.remove (slot);
+}
+
+void SamplerSynthesiser::moveVoiceToNote (SamplerVoice& voice, int midiNoteNumber)
+{
+    if (voice.getSlot() >= 0)
+        voicesByNote.insert (juce::jlimit (0, 127, midiNoteNumber), voice.getSlot());
+}
+
+void SamplerSynthesiser::chokeGroup (int group)
+{
+    if (group > maxChokeGroups)
+        return;
+
+    for (int slot = voicesByGroup.first (group); slot >= 0;)
+    {
+        auto* voice = samplerVoices[(size_t) slot];
+        slot = voicesByGroup.next (slot);
+
+        // Fading voices leave the group so a later hit doesn't choke them again
+        voice->choke();
+        voicesByGroup.remove (voice->getSlot());
+    }
+}
+
+SamplerVoice* SamplerSynthesiser::obtainVoice() const
+{
+    const auto slot = freeVoices.first (0);
+
+    if (slot >= 0)
+        return samplerVoices[(size_t) slot];
+
+    if (! isNoteStealingEnabled())
+        return nullptr;
+
+    // Steal the oldest voice, preferring ones that are already releasing
+    SamplerVoice* oldest = nullptr;
+    SamplerVoice* oldestReleasing = nullptr;
+
+    for (auto* voice : samplerVoices)
+    {
+        auto*& candidate = voice->isReleasing() ? oldestReleasing : oldest;
+
+        if (candidate == nullptr || voice->wasStartedBefore (*candidate))
+            candidate = voice;
+    }
+
+    return oldestReleasing != nullptr ? oldestReleasing : oldest;
+}
+
+//==============================================================================
+void SamplerSynthesiser::pushHeldNote (int midiNoteNumber) noexcept
+{
+    removeHeldNote (midiNoteNumber);
+
+    if (numHeldNotes == (int) heldNotes.size())
+        removeHeldNote (heldNotes[0]);
+
+    heldNotes[(size_t) numHeldNotes++] = midiNoteNumber;
+}
+
+void SamplerSynthesiser::removeHeldNote (int midiNoteNumber) noexcept
+{
+    for (int i = 0; i < numHeldNotes; ++i)
+    {
+        if (heldNotes[(size_t) i] == midiNoteNumber)
+        {
+            std::copy (heldNotes.begin() + i + 1, heldNotes.begin() + numHeldNotes, heldNotes.begin() + i);
+            --numHeldNotes;
+            return;
+        }
+    }
+}
@@ -0,0 +1,185 @@
+/*
+  ==============================================================================
+
+    SimpleSampler - WAV Sampler Plugin with Virtual Keyboard
+    SamplerSynthesiser.h - Voice management and output routing
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "SamplerVoice.h"
+#include "ProgramBank.h"
+
+//==============================================================================
+/**
+ * Doubly-linked lists threaded through voice slots. Each slot is in at most
+ * one list, and insert/remove are O(1).
+ */
+class VoiceSlotLists
+{
+public:
+    void reset (int numLists, int numSlots)
+    {
+        heads.assign ((size_t) numLists, -1);
+        links.assign ((size_t) numSlots, Links());
+    }
+
+    void insert (int list, int slot) noexcept
+    {
+        remove (slot);
+
+        auto& link = links[(size_t) slot];
+        link.list = list;
+        link.prev = -1;
+        link.next = heads[(size_t) list];
+
+        if (link.next >= 0)
+            links[(size_t) link.next].prev = slot;
+
+        heads[(size_t) list] = slot;
+    }
+
+    void remove (int slot) noexcept
+    {
+        auto& link = links[(size_t) slot];
+
+        if (link.list < 0)
+            return;
+
+        if (link.prev >= 0)
+            links[(size_t) link.prev].next = link.next;
+        else
+            heads[(size_t) link.list] = link.next;
+
+        if (link.next >= 0)
+            links[(size_t) link.next].prev = link.prev;
+
+        link = Links();
+    }
+
+    int first (int list) const noexcept    { return heads[(size_t) list]; }
+    int next (int slot) const noexcept     { return links[(size_t) slot].next; }
+    int getList (int slot) const noexcept  { return links[(size_t) slot].list; }
+
+private:
+    struct Links
+    {
+        int list = -1, prev = -1, next = -1;
+    };
+
+    std::vector<int> heads;
+    std::vector<Links> links;
+};
+
+//==============================================================================
+/**
+ * Synthesiser with choke groups, mono/legato modes and per-zone output routing.
+ *
+ * Voices are indexed by note, by choke group and by whether they are free, so
+ * note-on, note-off and choking only touch the voices involved instead of
+ * scanning the whole voice list.
+ */
+class SamplerSynthesiser : public juce::Synthesiser,
+                           private SamplerVoice::Listener
+{
+public:
+    static constexpr int maxOutputBuses = 8;
+    static constexpr int maxChokeGroups = 16;
+
+    enum class PlayMode { poly, mono, legato };
+
+    /** Where a bus lives inside the buffers passed to renderNextBlock. */
+    struct OutputBus
+    {
+        int firstChannel = 0;
+        int numChannels = 0;    // 0 when the host has disabled the bus
+    };
+
+    SamplerSynthesiser() = default;
+
+    /** Adds a voice and rebuilds the voice indexes; not for the audio thread. */
+    SamplerVoice* addSamplerVoice (SamplerVoice* newVoice);
+
+    /** Sets the bus layout; call from prepareToPlay, never while rendering. */
+    void setOutputBuses (const std::array<OutputBus, maxOutputBuses>& newBuses, int newNumBuses);
+
+    // Lets the realtime checks test whether rendering would block
+    const juce::CriticalSection& getLock() const noexcept  { return lock; }
+
+    // Set from the audio thread before rendering each block
+    void setPlayMode (PlayMode newMode) noexcept;
+    void setGlideTime (double newGlideSeconds) noexcept  { glideSeconds = newGlideSeconds; }
+
+    //==============================================================================
+    // Programs. With a bank set, notes play the selected program's kit instead of the
+    // synthesiser's own sounds.
+    void setProgramBank (const ProgramBank* newBank) noexcept   { bank = newBank; }
+
+    /** Audio thread: switches kits with a single pointer swap. Voices already playing
+        keep their sounds, so they finish on the previous kit. */
+    void selectProgram (int program) noexcept;
+
+    int getCurrentProgram() const noexcept              { return currentProgram.load(); }
+    const SamplerKit* getActiveKit() const noexcept     { return activeKit.load(); }
+
+    const juce::ReferenceCountedArray<juce::SynthesiserSound>& getActiveSounds() const noexcept
+    {
+        auto* kit = activeKit.load (std::memory_order_acquire);
+        return kit != nullptr ? kit->getSounds() : sounds;
+    }
+
+    //==============================================================================
+    void noteOn (int midiChannel, int midiNoteNumber, float velocity) override;
+    void noteOff (int midiChannel, int midiNoteNumber, float velocity, bool allowTailOff) override;
+    void allNotesOff (int midiChannel, bool allowTailOff) override;
+    void handleSustainPedal (int midiChannel, bool isDown) override;
+    void handleSostenutoPedal (int midiChannel, bool isDown) override;
+    void handleProgramChange (int midiChannel, int programNumber) override;
+
+protected:
+    void renderVoices (juce::AudioBuffer<float>& outputAudio, int startSample, int numSamples) override;
+    using juce::Synthesiser::renderVoices;
+
+private:
+    //==============================================================================
+    void voiceFinished (SamplerVoice& voice) override;
+
+    void rebuildVoiceIndex();
+    void registerVoice (SamplerVoice& voice, int midiNoteNumber);
+    void moveVoiceToNote (SamplerVoice& voice, int midiNoteNumber);
+    void chokeGroup (int group);
+    SamplerVoice* obtainVoice() const;
+
+    // Mono/legato note stack, most recent last
+    void pushHeldNote (int midiNoteNumber) noexcept;
+    void removeHeldNote (int midiNoteNumber) noexcept;
+
+    //==============================================================================
+    std::array<OutputBus, maxOutputBuses> outputBuses;
+    int numOutputBuses = 0;
+
+    // Views onto the channels of each bus, rebuilt for every rendered sub-block
+    std::array<juce::AudioBuffer<float>, maxOutputBuses> busViews;
+    std::array<bool, maxOutputBuses> busAvailable {};
+
+    // Voice indexes; list numbers are MIDI notes, choke groups, or 0 for the free list
+    std::vector<SamplerVoice*> samplerVoices;
+    VoiceSlotLists voicesByNote, voicesByGroup, freeVoices;
+
+    PlayMode playMode = PlayMode::poly;
+    double glideSeconds = 0.0;
+    SamplerVoice* monoVoice = nullptr;
+    std::array<int, 128> heldNotes {};
+    int numHeldNotes = 0;
+
+    juce::BigInteger sustainedChannels;
+
+    const ProgramBank* bank = nullptr;
+    std::atomic<const SamplerKit*> activeKit { nullptr };
+    std::atomic<int> currentProgram { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SamplerSynthesiser)
+};
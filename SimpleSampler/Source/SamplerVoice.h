@@ -0,0 +1,565 @@
+/*
+  ==============================================================================
+
+    SimpleSampler - WAV Sampler Plugin with Virtual Keyboard
+    SamplerVoice.h - Sample Sound and Voice
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "EnvelopeGenerator.h"
+#include "VoiceKernels.h"
+#include "GranularStretcher.h"
+#include "SampleLibrary.h"
+#include "NoteRenderCache.h"
+
+//==============================================================================
+/**
+ * Custom Sampler Sound - maps a shared, decoded sample onto a key range
+ */
+class SamplerSound : public juce::SynthesiserSound
+{
+public:
+    SamplerSound (SampleData::Ptr sampleData,
+                  const juce::BigInteger& midiNotes,
+                  int midiNoteForNormalPitch)
+        : sourceSampleRate (sampleData->getSampleRate()),
+          midiNotes (midiNotes),
+          midiRootNote (midiNoteForNormalPitch),
+          length (sampleData->getLength()),
+          loopEnd (sampleData->getLength()),
+          sample (std::move (sampleData))
+    {
+    }
+
+    bool appliesToNote (int midiNoteNumber) override
+    {
+        return midiNotes[midiNoteNumber];
+    }
+
+    bool appliesToChannel (int /*midiChannel*/) override
+    {
+        return true;
+    }
+
+    const juce::AudioBuffer<float>* getAudioData() const noexcept { return &sample->getAudio(); }
+    const SampleData& getSampleData() const noexcept              { return *sample; }
+    const SampleData::Ptr& getSharedSampleData() const noexcept   { return sample; }
+
+    // A copy sharing the same sample data, for building a new kit from an existing one
+    SamplerSound* createCopy() const
+    {
+        auto* copy = new SamplerSound (sample, midiNotes, midiRootNote);
+        copy->outputBus = outputBus;
+        copy->chokeGroup = chokeGroup;
+        copy->loopStart = loopStart;
+        copy->loopEnd = loopEnd;
+        return copy;
+    }
+
+    float getNormalisationGain() const noexcept         { return sample->getAnalysis().getNormalisationGain(); }
+    int getOnsetPosition (int onsetIndex) const noexcept { return sample->getAnalysis().getOnsetPosition (onsetIndex); }
+
+    // Source samples advanced per output sample when playing the given note
+    double getPitchRatio (int midiNoteNumber, double playbackSampleRate) const noexcept
+    {
+        return std::pow (2.0, (midiNoteNumber - midiRootNote) / 12.0) * sourceSampleRate / playbackSampleRate;
+    }
+
+    double sourceSampleRate;
+    juce::BigInteger midiNotes;
+    int midiRootNote, length;
+    int outputBus = 0;          // Output bus this zone's voices render into
+    int chokeGroup = 0;         // Voices in the same group cut each other off; 0 = none
+    int loopStart = 0;          // Loop region used when looping is on; the whole sample by default
+    int loopEnd = 0;
+
+private:
+    SampleData::Ptr sample;
+
+    JUCE_LEAK_DETECTOR (SamplerSound)
+};
+
+//==============================================================================
+/**
+ * Custom Sampler Voice - handles playback of the sample
+ */
+class SamplerVoice : public juce::SynthesiserVoice
+{
+public:
+    SamplerVoice() {}
+
+    // Envelope values are rendered this many samples at a time
+    static constexpr int envelopeChunkSize = 64;
+
+    // Per-voice scratch: the envelope chunk, then two mix and two grain chunks for time-stretching
+    static constexpr int scratchSize = envelopeChunkSize * 5;
+
+    /** Told when the voice stops sounding, so the owner can keep its indexes current. */
+    struct Listener
+    {
+        virtual ~Listener() = default;
+        virtual void voiceFinished (SamplerVoice&) = 0;
+    };
+
+    bool canPlaySound (juce::SynthesiserSound* sound) override
+    {
+        return dynamic_cast<const SamplerSound*> (sound) != nullptr;
+    }
+
+    void startNote (int midiNoteNumber, float velocity,
+                   juce::SynthesiserSound* s, int /*currentPitchWheelPosition*/) override
+    {
+        if (auto* sound = dynamic_cast<const SamplerSound*> (s))
+        {
+            pitchRatio = sound->getPitchRatio (midiNoteNumber, getSampleRate());
+            outputBus = sound->outputBus;
+            chokeGroup = sound->chokeGroup;
+            glideSamplesRemaining = 0.0;
+
+            sourceSamplePosition = sound->getOnsetPosition (startOnset);
+            lgain = velocity * (normalise ? sound->getNormalisationGain() : 1.0f);
+            rgain = lgain;
+
+            // Stretching is latched per note so a running note never switches engines
+            stretching = timeStretchEnabled;
+
+            if (stretching)
+                stretcher.start (sourceSamplePosition);
+
+            // A repeated one-shot plays its pre-rendered copy if there is one; the first
+            // trigger interpolates and asks the cache to build it
+            cachedRender = nullptr;
+            cachedRenderPosition = 0;
+
+            if (renderCache != nullptr && useRenderCache && ! stretching && ! isLooping (*sound))
+                cachedRender = renderCache->lookup (sound->getSharedSampleData(), sourceSamplePosition,
+                                                    pitchRatio / oversamplingFactor, interpolation);
+
+            envelope.noteOn();
+        }
+        else
+        {
+            jassertfalse; // This should never happen!
+        }
+    }
+
+    void stopNote (float /*velocity*/, bool allowTailOff) override
+    {
+        if (allowTailOff)
+        {
+            envelope.noteOff();
+        }
+        else
+        {
+            envelope.reset();
+            finishNote();
+        }
+    }
+
+    void pitchWheelMoved (int /*newValue*/) override {}
+    void controllerMoved (int /*controllerNumber*/, int /*newValue*/) override {}
+
+    void setCurrentPlaybackSampleRate (double newRate) override
+    {
+        juce::SynthesiserVoice::setCurrentPlaybackSampleRate (newRate);
+
+        // The envelope advances once per output sample, so it runs at the render rate
+        if (newRate > 0.0)
+            envelope.setSampleRate (newRate * oversamplingFactor);
+    }
+
+    // Renders at this multiple of the host rate; only changed between blocks
+    void setOversamplingFactor (int newFactor) noexcept
+    {
+        if (oversamplingFactor != newFactor)
+        {
+            oversamplingFactor = newFactor;
+
+            if (getSampleRate() > 0.0)
+                envelope.setSampleRate (getSampleRate() * oversamplingFactor);
+        }
+    }
+
+    double getPitchRatio() const noexcept { return pitchRatio; }
+    int getOutputBus() const noexcept     { return outputBus; }
+    int getChokeGroup() const noexcept    { return chokeGroup; }
+    bool isReleasing() const noexcept     { return envelope.isReleasing(); }
+
+    //==============================================================================
+    // Voice management state, owned by SamplerSynthesiser
+    void setListener (Listener* newListener, int newSlot) noexcept
+    {
+        listener = newListener;
+        slot = newSlot;
+    }
+
+    int getSlot() const noexcept                        { return slot; }
+    bool isKeyHeld() const noexcept                     { return keyHeld; }
+    void setKeyHeld (bool shouldBeHeld) noexcept        { keyHeld = shouldBeHeld; }
+    bool isSostenutoHeld() const noexcept               { return sostenutoHeld; }
+    void setSostenutoHeld (bool shouldBeHeld) noexcept  { sostenutoHeld = shouldBeHeld; }
+
+    // Fades out over a few milliseconds, ignoring the release time
+    void choke() noexcept
+    {
+        envelope.fadeOut (chokeFadeSeconds);
+    }
+
+    // Slides the playing note to another pitch without retriggering
+    void glideTo (int midiNoteNumber, double glideSeconds) noexcept
+    {
+        if (auto* sound = static_cast<SamplerSound*> (getCurrentlyPlayingSound().get()))
+            startGlide (pitchRatio, sound->getPitchRatio (midiNoteNumber, getSampleRate()), glideSeconds);
+    }
+
+    // Starts the playing note at another note's pitch and slides to its own
+    void glideFrom (int midiNoteNumber, double glideSeconds) noexcept
+    {
+        if (auto* sound = static_cast<SamplerSound*> (getCurrentlyPlayingSound().get()))
+            startGlide (sound->getPitchRatio (midiNoteNumber, getSampleRate()), pitchRatio, glideSeconds);
+    }
+
+    // scratchSize floats, handed out from the processor's arena
+    void setScratchBuffer (float* newScratch) noexcept
+    {
+        envelopeBuffer = newScratch;
+    }
+
+    // Called once per block; picks which render kernel the next block uses
+    void setPlaybackOptions (VoiceKernels::Interpolation newInterpolation, VoiceKernels::LoopMode newLoopMode) noexcept
+    {
+        interpolation = newInterpolation;
+        loopMode = newLoopMode;
+    }
+
+    // Called once per block; the rate is source speed independent of pitch, 1 = original.
+    // Turning stretching on or off takes effect from the next note.
+    void setTimeStretch (bool shouldStretch, double newRate) noexcept
+    {
+        timeStretchEnabled = shouldStretch;
+        stretchRate = newRate;
+    }
+
+    // Called once per block; both take effect from the next note
+    void setStartOptions (bool shouldNormalise, int newStartOnset) noexcept
+    {
+        normalise = shouldNormalise;
+        startOnset = newStartOnset;
+    }
+
+    // Shared by all voices; set once before playback starts
+    void setRenderCache (NoteRenderCache* newCache) noexcept
+    {
+        renderCache = newCache;
+    }
+
+    // Called once per block; takes effect from the next note
+    void setRenderCacheEnabled (bool shouldUseCache) noexcept
+    {
+        useRenderCache = shouldUseCache;
+    }
+
+    // Called once per block; the envelope only recalculates when something changed
+    void setEnvelopeParameters (const EnvelopeGenerator::Parameters& newParameters) noexcept
+    {
+        envelope.setParameters (newParameters);
+    }
+
+    void renderNextBlock (juce::AudioBuffer<float>& outputBuffer, int startSample, int numSamples) override
+    {
+        jassert (envelopeBuffer != nullptr); // setScratchBuffer must be called in prepareToPlay
+
+        if (auto* playingSound = static_cast<SamplerSound*> (getCurrentlyPlayingSound().get()))
+        {
+            if (envelopeBuffer == nullptr)
+                return;
+
+            if (stretching)
+            {
+                renderStretched (*playingSound, outputBuffer, startSample, numSamples);
+                return;
+            }
+
+            if (cachedRender != nullptr)
+            {
+                // A glide, oversampling or option change means the cached copy no longer
+                // matches, so pick up interpolating from the same point
+                if (cachedRender->key.increment == pitchRatio / oversamplingFactor
+                     && cachedRender->key.interpolation == interpolation && ! isLooping (*playingSound))
+                {
+                    renderCached (outputBuffer, startSample, numSamples);
+                    return;
+                }
+
+                sourceSamplePosition = cachedRender->key.startPosition + cachedRenderPosition * cachedRender->key.increment;
+                cachedRender = nullptr;
+            }
+
+            auto& data = *playingSound->getAudioData();
+
+            VoiceKernels::RenderContext context;
+            context.inL = data.getReadPointer (0);
+            context.inR = data.getNumChannels() > 1 ? data.getReadPointer (1) : nullptr;
+            context.outL = outputBuffer.getWritePointer (0, startSample);
+            context.outR = outputBuffer.getNumChannels() > 1 ? outputBuffer.getWritePointer (1, startSample) : nullptr;
+            context.envelope = envelopeBuffer;
+            context.position = sourceSamplePosition;
+            context.endPosition = playingSound->length;
+            context.loopStart = playingSound->loopStart;
+            context.loopEnd = playingSound->loopEnd;
+            context.gainL = lgain;
+            context.gainR = rgain;
+
+            // Layout and options are fixed for the block, so choose the kernel once here
+            const auto canLoop = playingSound->loopEnd > playingSound->loopStart;
+            const auto kernel = VoiceKernels::getKernel (data.getNumChannels(), outputBuffer.getNumChannels(), interpolation,
+                                                         canLoop ? loopMode : VoiceKernels::LoopMode::oneShot);
+
+            // Render the envelope a chunk at a time so the gain multiply stays a flat loop.
+            // Glides also update once per chunk.
+            while (numSamples > 0)
+            {
+                const int numThisChunk = juce::jmin (numSamples, envelopeChunkSize);
+                envelope.render (envelopeBuffer, numThisChunk);
+
+                context.increment = pitchRatio / oversamplingFactor;
+                kernel (context, numThisChunk);
+                sourceSamplePosition = context.position;
+
+                if (context.isFinished())
+                {
+                    stopNote (0.0f, false);
+                    return;
+                }
+
+                numSamples -= numThisChunk;
+                advanceGlide (numThisChunk);
+
+                if (! envelope.isActive())
+                {
+                    finishNote();
+                    return;
+                }
+            }
+        }
+    }
+
+private:
+    bool isLooping (const SamplerSound& sound) const noexcept
+    {
+        return loopMode == VoiceKernels::LoopMode::forward && sound.loopEnd > sound.loopStart;
+    }
+
+    // Same arithmetic as the kernels, (sample * gain) * envelope, so the output is identical
+    void renderCached (juce::AudioBuffer<float>& outputBuffer, int startSample, int numSamples)
+    {
+        auto& cached = cachedRender->audio;
+        const auto stereoSource = cached.getNumChannels() > 1;
+
+        auto* outL = outputBuffer.getWritePointer (0, startSample);
+        auto* outR = outputBuffer.getNumChannels() > 1 ? outputBuffer.getWritePointer (1, startSample) : nullptr;
+
+        auto* mixL = envelopeBuffer + envelopeChunkSize;
+        auto* mixR = mixL + envelopeChunkSize;
+
+        while (numSamples > 0)
+        {
+            const int numThisChunk = juce::jmin (numSamples, envelopeChunkSize);
+            envelope.render (envelopeBuffer, numThisChunk);
+
+            // The note ends after the last cached sample, like the kernel's one-shot end
+            const int numToCopy = juce::jmin (numThisChunk, cachedRender->length - cachedRenderPosition);
+            const auto* inL = cached.getReadPointer (0, cachedRenderPosition);
+            const auto* inR = stereoSource ? cached.getReadPointer (1, cachedRenderPosition) : inL;
+
+            juce::FloatVectorOperations::multiply (mixL, inL, lgain, numToCopy);
+            juce::FloatVectorOperations::multiply (mixR, inR, rgain, numToCopy);
+
+            if (outR != nullptr)
+            {
+                juce::FloatVectorOperations::addWithMultiply (outL, mixL, envelopeBuffer, numToCopy);
+                juce::FloatVectorOperations::addWithMultiply (outR, mixR, envelopeBuffer, numToCopy);
+                outR += numThisChunk;
+            }
+            else
+            {
+                juce::FloatVectorOperations::multiply (mixL, envelopeBuffer, numToCopy);
+                juce::FloatVectorOperations::multiply (mixR, envelopeBuffer, numToCopy);
+                juce::FloatVectorOperations::add (mixL, mixR, numToCopy);
+                juce::FloatVectorOperations::addWithMultiply (outL, mixL, 0.5f, numToCopy);
+            }
+
+            outL += numThisChunk;
+            cachedRenderPosition += numToCopy;
+
+            if (cachedRenderPosition >= cachedRender->length)
+            {
+                stopNote (0.0f, false);
+                return;
+            }
+
+            numSamples -= numThisChunk;
+            advanceGlide (numThisChunk);
+
+            if (! envelope.isActive())
+            {
+                finishNote();
+                return;
+            }
+        }
+    }
+
+    void renderStretched (const SamplerSound& sound, juce::AudioBuffer<float>& outputBuffer, int startSample, int numSamples)
+    {
+        auto& data = *sound.getAudioData();
+        const auto stereoSource = data.getNumChannels() > 1;
+
+        GranularStretcher::Source source;
+        source.inL = data.getReadPointer (0);
+        source.inR = stereoSource ? data.getReadPointer (1) : nullptr;
+        source.endPosition = sound.length;
+        source.loopStart = sound.loopStart;
+        source.loopEnd = sound.loopEnd;
+        source.looping = loopMode == VoiceKernels::LoopMode::forward && sound.loopEnd > sound.loopStart;
+
+        auto* outL = outputBuffer.getWritePointer (0, startSample);
+        auto* outR = outputBuffer.getNumChannels() > 1 ? outputBuffer.getWritePointer (1, startSample) : nullptr;
+
+        auto* mixL = envelopeBuffer + envelopeChunkSize;
+        auto* mixR = mixL + envelopeChunkSize;
+        auto* grainScratch = mixR + envelopeChunkSize;
+        const auto* mixRight = stereoSource ? mixR : mixL;
+
+        const auto timelineIncrement = stretchRate * sound.sourceSampleRate / (getSampleRate() * oversamplingFactor);
+
+        while (numSamples > 0)
+        {
+            const int numThisChunk = juce::jmin (numSamples, envelopeChunkSize);
+            envelope.render (envelopeBuffer, numThisChunk);
+
+            stretcher.render (source, pitchRatio / oversamplingFactor, timelineIncrement,
+                              mixL, mixR, grainScratch, numThisChunk);
+
+            juce::FloatVectorOperations::multiply (mixL, envelopeBuffer, numThisChunk);
+
+            if (stereoSource)
+                juce::FloatVectorOperations::multiply (mixR, envelopeBuffer, numThisChunk);
+
+            if (outR != nullptr)
+            {
+                juce::FloatVectorOperations::addWithMultiply (outL, mixL, lgain, numThisChunk);
+                juce::FloatVectorOperations::addWithMultiply (outR, mixRight, rgain, numThisChunk);
+                outR += numThisChunk;
+            }
+            else
+            {
+                juce::FloatVectorOperations::addWithMultiply (outL, mixL, lgain * 0.5f, numThisChunk);
+                juce::FloatVectorOperations::addWithMultiply (outL, mixRight, rgain * 0.5f, numThisChunk);
+            }
+
+            outL += numThisChunk;
+
+            if (stretcher.isFinished())
+            {
+                stopNote (0.0f, false);
+                return;
+            }
+
+            numSamples -= numThisChunk;
+            advanceGlide (numThisChunk);
+
+            if (! envelope.isActive())
+            {
+                finishNote();
+                return;
+            }
+        }
+    }
+
+    void finishNote()
+    {
+        // The cache keeps its own reference, so this never frees anything on the audio thread
+        cachedRender = nullptr;
+        clearCurrentNote();
+
+        if (listener != nullptr)
+            listener->voiceFinished (*this);
+    }
+
+    void startGlide (double fromRatio, double toRatio, double glideSeconds) noexcept
+    {
+        glideTarget = toRatio;
+        glideSamplesRemaining = glideSeconds * getSampleRate();
+
+        if (glideSamplesRemaining < 1.0 || fromRatio <= 0.0 || toRatio <= 0.0)
+        {
+            pitchRatio = toRatio;
+            glideSamplesRemaining = 0.0;
+            return;
+        }
+
+        // Exponential in ratio, i.e. linear in pitch
+        pitchRatio = fromRatio;
+        glideLogStep = std::log (toRatio / fromRatio) / glideSamplesRemaining;
+    }
+
+    void advanceGlide (int numRenderedSamples) noexcept
+    {
+        if (glideSamplesRemaining <= 0.0)
+            return;
+
+        // Glide times are in host samples
+        const auto hostSamples = (double) numRenderedSamples / oversamplingFactor;
+
+        if (hostSamples >= glideSamplesRemaining)
+        {
+            pitchRatio = glideTarget;
+            glideSamplesRemaining = 0.0;
+        }
+        else
+        {
+            pitchRatio *= std::exp (glideLogStep * hostSamples);
+            glideSamplesRemaining -= hostSamples;
+        }
+    }
+
+    //==============================================================================
+    double pitchRatio = 0.0;
+    double sourceSamplePosition = 0.0;
+    float lgain = 0.0f, rgain = 0.0f;
+    int oversamplingFactor = 1;
+    int outputBus = 0;
+    int chokeGroup = 0;
+
+    VoiceKernels::Interpolation interpolation = VoiceKernels::Interpolation::linear;
+    VoiceKernels::LoopMode loopMode = VoiceKernels::LoopMode::oneShot;
+
+    bool normalise = false;
+    int startOnset = 0;
+
+    bool timeStretchEnabled = false, stretching = false;
+    double stretchRate = 1.0;
+    GranularStretcher stretcher;
+
+    NoteRenderCache* renderCache = nullptr;
+    bool useRenderCache = false;
+    NoteRenderCache::Entry::Ptr cachedRender;
+    int cachedRenderPosition = 0;
+
+    double glideTarget = 0.0, glideSamplesRemaining = 0.0, glideLogStep = 0.0;
+
+    static constexpr float chokeFadeSeconds = 0.005f;
+
+    Listener* listener = nullptr;
+    int slot = -1;
+    bool keyHeld = false, sostenutoHeld = false;
+
+    EnvelopeGenerator envelope;
+    float* envelopeBuffer = nullptr;    // Start of the voice's scratch
+
+    JUCE_LEAK_DETECTOR (SamplerVoice)
+};
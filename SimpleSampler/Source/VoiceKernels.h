@@ -0,0 +1,255 @@
+/*
+  ==============================================================================
+
+    SimpleSampler - WAV Sampler Plugin with Virtual Keyboard
+    VoiceKernels.h - Sample playback inner loops
+
+    The per-sample work of SamplerVoice lives here as free functions over
+    raw pointers, so it can be driven on its own without a synthesiser,
+    sound or voice.
+
+    Each kernel is a template specialised on source channel count, output
+    channel count, interpolation and loop mode, so its inner loop carries
+    no per-sample branches on any of them. getKernel() picks the right
+    instantiation from a table once per block.
+
+    When looping, the few samples whose interpolation taps reach the loop
+    end are rendered separately with those taps read from the loop start,
+    so the seam interpolates across the loop instead of into whatever
+    follows it.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+namespace VoiceKernels
+{
+    //==============================================================================
+    enum class Interpolation { linear, cubic };
+    enum class LoopMode { oneShot, forward };
+
+    /** Inputs and running state for one call of a voice render kernel. */
+    struct RenderContext
+    {
+        const float* inL = nullptr;
+        const float* inR = nullptr;     // nullptr for a mono source
+        float* outL = nullptr;
+        float* outR = nullptr;          // nullptr for a mono output
+        const float* envelope = nullptr;
+
+        double position = 0.0;          // Read position in source samples
+        double increment = 0.0;         // Source samples per output sample
+        double endPosition = 0.0;       // One-shot rendering stops once position passes this
+        double loopStart = 0.0;         // Looping wraps from loopEnd back to loopStart; both
+        double loopEnd = 0.0;           // are whole sample indexes
+
+        float gainL = 0.0f, gainR = 0.0f;
+
+        bool isFinished() const noexcept { return position > endPosition; }
+    };
+
+    /** Renders up to numSamples and returns the number written. */
+    using KernelFunction = int (*) (RenderContext&, int numSamples);
+
+    //==============================================================================
+    namespace detail
+    {
+        template <Interpolation interpolation>
+        inline float interpolate (const float* in, int pos, float alpha) noexcept
+        {
+            if constexpr (interpolation == Interpolation::linear)
+            {
+                return in[pos] * (1.0f - alpha) + in[pos + 1] * alpha;
+            }
+            else
+            {
+                // 4-point Catmull-Rom; the sample before the start repeats the first one
+                const auto xm1 = in[juce::jmax (0, pos - 1)];
+                const auto x0  = in[pos];
+                const auto x1  = in[pos + 1];
+                const auto x2  = in[pos + 2];
+
+                const auto c1 = 0.5f * (x1 - xm1);
+                const auto c2 = xm1 - 2.5f * x0 + 2.0f * x1 - 0.5f * x2;
+                const auto c3 = 0.5f * (x2 - xm1) + 1.5f * (x0 - x1);
+
+                return ((c3 * alpha + c2) * alpha + c1) * alpha + x0;
+            }
+        }
+
+        /** The same taps as interpolate(), except that those at or past the loop end
+            are read from the loop start. */
+        template <Interpolation interpolation>
+        inline float interpolateAcrossLoopEnd (const float* in, int pos, float alpha,
+                                               int loopStart, int loopEnd) noexcept
+        {
+            std::array<float, 4> taps;
+
+            for (int i = 0; i < 4; ++i)
+            {
+                auto index = pos - 1 + i;
+
+                if (index >= loopEnd)
+                    index = loopStart + (index - loopEnd) % (loopEnd - loopStart);
+
+                taps[(size_t) i] = in[juce::jmax (0, index)];
+            }
+
+            return interpolate<interpolation> (taps.data(), 1, alpha);
+        }
+
+        /** How many samples past pos the interpolation reads. */
+        template <Interpolation interpolation>
+        constexpr int getTapsAhead() noexcept
+        {
+            return interpolation == Interpolation::cubic ? 2 : 1;
+        }
+
+        /** Samples rendered before the position reaches boundary, never negative. */
+        inline int samplesBefore (double boundary, double position, double increment) noexcept
+        {
+            const auto n = std::ceil ((boundary - position) / increment);
+            return n < 0.0 ? 0 : (int) juce::jmin (n, 1.0e9);
+        }
+
+        /** Samples that can be rendered before the position passes the one-shot end,
+            so the inner loop needs no boundary test. */
+        inline int samplesToEnd (const RenderContext& context) noexcept
+        {
+            const auto n = std::floor ((context.endPosition - context.position) / context.increment) + 1.0;
+            return n < 1.0 ? 1 : (int) juce::jmin (n, 1.0e9);
+        }
+    }
+
+    //==============================================================================
+    /** Interpolates the source, applies gain and envelope and adds it to the output.
+        One-shot playback stops after the sample that moves the position past the end;
+        forward looping wraps at the loop end and only stops when numSamples is done. */
+    template <int numSourceChannels, int numOutputChannels, Interpolation interpolation, LoopMode loopMode>
+    int render (RenderContext& context, int numSamples) noexcept
+    {
+        static_assert (numSourceChannels == 1 || numSourceChannels == 2, "Mono or stereo sources only");
+        static_assert (numOutputChannels == 1 || numOutputChannels == 2, "Mono or stereo outputs only");
+
+        const auto* const inL = context.inL;
+        const auto* const inR = numSourceChannels == 2 ? context.inR : context.inL;
+        auto* outL = context.outL;
+        auto* outR = context.outR;
+        const auto* envelope = context.envelope;
+
+        const auto gainL = context.gainL;
+        const auto gainR = context.gainR;
+        const auto increment = context.increment;
+        auto position = context.position;
+
+        int numDone = 0;
+
+        // Renders a run with no boundary inside it, reading the source through interpolateAt
+        auto renderRun = [&] (int numThisRun, auto&& interpolateAt)
+        {
+            for (int i = 0; i < numThisRun; ++i)
+            {
+                const auto pos = (int) position;
+                const auto alpha = (float) (position - pos);
+
+                const auto env = envelope[i];
+                const auto l = interpolateAt (inL, pos, alpha) * gainL * env;
+                const auto r = interpolateAt (inR, pos, alpha) * gainR * env;
+
+                if constexpr (numOutputChannels == 2)
+                {
+                    outL[i] += l;
+                    outR[i] += r;
+                }
+                else
+                {
+                    outL[i] += (l + r) * 0.5f;
+                }
+
+                position += increment;
+            }
+
+            outL += numThisRun;
+
+            if constexpr (numOutputChannels == 2)
+                outR += numThisRun;
+
+            envelope += numThisRun;
+            numDone += numThisRun;
+        };
+
+        auto interpolateDirect = [] (const float* in, int pos, float alpha)
+        {
+            return detail::interpolate<interpolation> (in, pos, alpha);
+        };
+
+        while (numDone < numSamples)
+        {
+            if constexpr (loopMode == LoopMode::forward)
+            {
+                const auto loopStart = (int) context.loopStart;
+                const auto loopEnd = (int) context.loopEnd;
+
+                // Up to where the taps would reach the loop end, then on to the loop end itself
+                const auto numToSeam = detail::samplesBefore (loopEnd - detail::getTapsAhead<interpolation>(), position, increment);
+                const auto numToLoopEnd = juce::jmax (1, detail::samplesBefore (loopEnd, position, increment));
+
+                renderRun (juce::jmin (numSamples - numDone, numToSeam), interpolateDirect);
+
+                renderRun (juce::jmin (numSamples - numDone, numToLoopEnd - numToSeam),
+                           [loopStart, loopEnd] (const float* in, int pos, float alpha)
+                           {
+                               return detail::interpolateAcrossLoopEnd<interpolation> (in, pos, alpha, loopStart, loopEnd);
+                           });
+
+                // fmod rather than one subtraction, in case a step is longer than the loop
+                if (position >= context.loopEnd)
+                    position = context.loopStart + std::fmod (position - context.loopStart,
+                                                              context.loopEnd - context.loopStart);
+            }
+            else
+            {
+                context.position = position;
+                renderRun (juce::jmin (numSamples - numDone, detail::samplesToEnd (context)), interpolateDirect);
+
+                if (position > context.endPosition)
+                    break;
+            }
+        }
+
+        context.outL = outL;
+        context.outR = outR;
+        context.position = position;
+        return numDone;
+    }
+
+    //==============================================================================
+    /** Looks up the kernel for the given layout and playback options. */
+    inline KernelFunction getKernel (int numSourceChannels, int numOutputChannels,
+                                     Interpolation interpolation, LoopMode loopMode) noexcept
+    {
+        using I = Interpolation;
+        using L = LoopMode;
+
+        // Indexed by [source stereo][output stereo][cubic][looping]
+        static constexpr KernelFunction table[2][2][2][2] =
+        {
+            { { { render<1, 1, I::linear, L::oneShot>, render<1, 1, I::linear, L::forward> },
+                { render<1, 1, I::cubic,  L::oneShot>, render<1, 1, I::cubic,  L::forward> } },
+              { { render<1, 2, I::linear, L::oneShot>, render<1, 2, I::linear, L::forward> },
+                { render<1, 2, I::cubic,  L::oneShot>, render<1, 2, I::cubic,  L::forward> } } },
+            { { { render<2, 1, I::linear, L::oneShot>, render<2, 1, I::linear, L::forward> },
+                { render<2, 1, I::cubic,  L::oneShot>, render<2, 1, I::cubic,  L::forward> } },
+              { { render<2, 2, I::linear, L::oneShot>, render<2, 2, I::linear, L::forward> },
+                { render<2, 2, I::cubic,  L::oneShot>, render<2, 2, I::cubic,  L::forward> } } }
+        };
+
+        return table[numSourceChannels > 1 ? 1 : 0]
+                    [numOutputChannels > 1 ? 1 : 0]
+                    [interpolation == Interpolation::cubic ? 1 : 0]
+                    [loopMode == LoopMode::forward ? 1 : 0];
+    }
+}
@@ -0,0 +1,88 @@
+/*
+  ==============================================================================
+
+    SimpleSampler - WAV Sampler Plugin with Virtual Keyboard
+    Benchmarks.cpp - Timing harness for the kernel and engine benchmarks
+
+  ==============================================================================
+*/
+
+#include "Benchmarks.h"
+
+namespace Benchmarks
+{
+    //==============================================================================
+    juce::var Result::toVar() const
+    {
+        auto* parametersObject = new juce::DynamicObject();
+
+        for (const auto& parameter : parameters)
+            parametersObject->setProperty (parameter.name, parameter.value);
+
+        auto* object = new juce::DynamicObject();
+        object->setProperty ("benchmark", benchmark);
+        object->setProperty ("name", name);
+        object->setProperty ("parameters", juce::var (parametersObject));
+        object->setProperty ("iterations", iterations);
+        object->setProperty ("meanNs", meanNs);
+        object->setProperty ("minNs", minNs);
+        object->setProperty ("maxNs", maxNs);
+        object->setProperty ("nsPerItem", nsPerItem);
+        return juce::var (object);
+    }
+
+    //==============================================================================
+    const Result& Runner::addResult (const juce::String& name, const juce::NamedValueSet& parameters,
+                                     double itemsPerCall, const std::vector<juce::int64>& times)
+    {
+        jassert (! times.empty());
+
+        const auto nsPerTick = 1.0e9 / (double) juce::Time::getHighResolutionTicksPerSecond();
+        const auto [minTicks, maxTicks] = std::minmax_element (times.begin(), times.end());
+        const auto totalTicks = std::accumulate (times.begin(), times.end(), (juce::int64) 0);
+
+        Result result;
+        result.benchmark = currentBenchmark;
+        result.name = name;
+        result.parameters = parameters;
+        result.iterations = (int) times.size();
+        result.meanNs = (double) totalTicks * nsPerTick / (double) times.size();
+        result.minNs = (double) *minTicks * nsPerTick;
+        result.maxNs = (double) *maxTicks * nsPerTick;
+        result.nsPerItem = result.meanNs / juce::jmax (1.0, itemsPerCall);
+
+        results.push_back (result);
+        return results.back();
+    }
+
+    juce::String Runner::toJson() const
+    {
+        juce::Array<juce::var> resultList;
+
+        for (const auto& result : results)
+            resultList.add (result.toVar());
+
+        auto* object = new juce::DynamicObject();
+        object->setProperty ("quick", quick);
+        object->setProperty ("results", resultList);
+        return juce::JSON::toString (juce::var (object));
+    }
+
+    //==============================================================================
+    Benchmark::Benchmark (const juce::String& benchmarkName)
+        : name (benchmarkName)
+    {
+        getAllBenchmarks().add (this);
+    }
+
+    Benchmark::~Benchmark()
+    {
+        getAllBenchmarks().removeFirstMatchingValue (this);
+    }
+
+    juce::Array<Benchmark*>& Benchmark::getAllBenchmarks()
+    {
+        static juce::Array<Benchmark*> benchmarks;
+        return benchmarks;
+    }
+}
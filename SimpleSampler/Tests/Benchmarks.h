@@ -0,0 +1,111 @@
+/*
+  ==============================================================================
+
+    SimpleSampler - WAV Sampler Plugin with Virtual Keyboard
+    Benchmarks.h - Timing harness for the kernel and engine benchmarks
+
+    A benchmark is a class derived from Benchmarks::Benchmark with a static
+    instance, in the same way as juce::UnitTest; it registers itself and is
+    run by SimpleSamplerTests. Each measured case records its parameters and
+    the time per call and per item (a sample, voice-sample or event), and
+    the whole run can be written out as JSON for comparing builds.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+namespace Benchmarks
+{
+    //==============================================================================
+    /** Timings of one measured case, in nanoseconds. */
+    struct Result
+    {
+        juce::String benchmark, name;
+        juce::NamedValueSet parameters;
+        int iterations = 0;
+        double meanNs = 0.0, minNs = 0.0, maxNs = 0.0;
+        double nsPerItem = 0.0;
+
+        juce::var toVar() const;
+    };
+
+    //==============================================================================
+    class Runner
+    {
+    public:
+        /** Quick runs measure for a tenth of the time and benchmarks may skip cases. */
+        void setQuick (bool shouldBeQuick) noexcept     { quick = shouldBeQuick; }
+        bool isQuick() const noexcept                   { return quick; }
+
+        /** Calls function repeatedly, first to warm up and then for the measuring time,
+            and records the time of each call. itemsPerCall is what nsPerItem divides by. */
+        template <typename Function>
+        const Result& measure (const juce::String& name, const juce::NamedValueSet& parameters,
+                               double itemsPerCall, Function&& function)
+        {
+            const auto warmUpEnd = juce::Time::getHighResolutionTicks() + juce::Time::secondsToHighResolutionTicks (getMeasuringSeconds() * 0.1);
+
+            while (juce::Time::getHighResolutionTicks() < warmUpEnd)
+                function();
+
+            std::vector<juce::int64> times;
+            times.reserve (maxIterations);
+
+            const auto measuringEnd = juce::Time::getHighResolutionTicks() + juce::Time::secondsToHighResolutionTicks (getMeasuringSeconds());
+
+            while (times.size() < maxIterations && (times.size() < minIterations || juce::Time::getHighResolutionTicks() < measuringEnd))
+            {
+                const auto start = juce::Time::getHighResolutionTicks();
+                function();
+                times.push_back (juce::Time::getHighResolutionTicks() - start);
+            }
+
+            return addResult (name, parameters, itemsPerCall, times);
+        }
+
+        /** Records timings taken by the benchmark itself, for cases that can't be repeated
+            call by call (each entry is one call, in high resolution ticks). */
+        const Result& addResult (const juce::String& name, const juce::NamedValueSet& parameters,
+                                 double itemsPerCall, const std::vector<juce::int64>& times);
+
+        void setCurrentBenchmark (const juce::String& benchmarkName)    { currentBenchmark = benchmarkName; }
+
+        const std::vector<Result>& getResults() const noexcept          { return results; }
+
+        /** { "quick": ..., "results": [ { "benchmark", "name", "parameters", "iterations",
+            "meanNs", "minNs", "maxNs", "nsPerItem" }, ... ] } */
+        juce::String toJson() const;
+
+    private:
+        double getMeasuringSeconds() const noexcept     { return quick ? 0.02 : 0.2; }
+
+        static constexpr size_t minIterations = 5, maxIterations = 100000;
+
+        std::vector<Result> results;
+        juce::String currentBenchmark;
+        bool quick = false;
+    };
+
+    //==============================================================================
+    class Benchmark
+    {
+    public:
+        explicit Benchmark (const juce::String& name);
+        virtual ~Benchmark();
+
+        const juce::String& getName() const noexcept    { return name; }
+
+        /** Measures every case of the benchmark through the runner. */
+        virtual void run (Runner& runner) = 0;
+
+        static juce::Array<Benchmark*>& getAllBenchmarks();
+
+    private:
+        const juce::String name;
+
+        JUCE_DECLARE_NON_COPYABLE (Benchmark)
+    };
+}
@@ -0,0 +1,160 @@
+/*
+  ==============================================================================
+
+    SimpleSampler - WAV Sampler Plugin with Virtual Keyboard
+    EngineBenchmarks.cpp - Whole-processor benchmarks
+
+  ==============================================================================
+*/
+
+#include "Benchmarks.h"
+#include "EngineFixtures.h"
+
+#if JUCE_MAC
+ #include <mach/mach.h>
+#elif JUCE_WINDOWS
+ #include <windows.h>
+ #include <psapi.h>
+#elif JUCE_LINUX
+ #include <unistd.h>
+#endif
+
+//==============================================================================
+/** processBlock time as the number of MIDI events per block goes up. The maximum is the
+    worst callback seen, which is what decides whether a host drops out. */
+class MidiFloodBenchmark  : public Benchmarks::Benchmark
+{
+public:
+    MidiFloodBenchmark() : Benchmarks::Benchmark ("midi_flood") {}
+
+    void run (Benchmarks::Runner& runner) override
+    {
+        const auto eventCounts = runner.isQuick() ? std::vector<int> { 0, 256, 2048 }
+                                                  : std::vector<int> { 0, 8, 32, 128, 512, 2048 };
+
+        for (auto blockSize : { 128, 512 })
+            for (auto numEvents : eventCounts)
+                measure (runner, blockSize, numEvents);
+    }
+
+private:
+    static constexpr double sampleRate = 48000.0;
+    static constexpr int numPatterns = 16;
+
+    static void measure (Benchmarks::Runner& runner, int blockSize, int numEvents)
+    {
+        SimpleSamplerAudioProcessor processor;
+
+        if (! EngineFixtures::prepare (processor, sampleRate, blockSize))
+        {
+            jassertfalse;
+            return;
+        }
+
+        // Built up front so only processBlock is timed; processBlock leaves its MIDI alone
+        std::vector<juce::MidiBuffer> patterns ((size_t) numPatterns);
+
+        for (size_t i = 0; i < patterns.size(); ++i)
+            EngineFixtures::addMidiFlood (patterns[i], numEvents, blockSize, (juce::uint32) (i + 1));
+
+        juce::AudioBuffer<float> buffer (processor.getTotalNumOutputChannels(), blockSize);
+        size_t nextPattern = 0;
+
+        juce::NamedValueSet parameters;
+        parameters.set ("eventsPerBlock", numEvents);
+        parameters.set ("blockSize", blockSize);
+        parameters.set ("blockDurationNs", 1.0e9 * blockSize / sampleRate);
+
+        // Items are events, so nsPerItem is the cost of one event including the audio it
+        // triggers; with no events it is the cost of the whole block
+        runner.measure (juce::String (numEvents) + " events per " + juce::String (blockSize) + " samples",
+                        parameters, (double) juce::jmax (1, numEvents), [&]
+        {
+            buffer.clear();
+            processor.processBlock (buffer, patterns[nextPattern]);
+            nextPattern = (nextPattern + 1) % patterns.size();
+        });
+
+        processor.releaseResources();
+    }
+};
+
+static MidiFloodBenchmark midiFloodBenchmark;
+
+//==============================================================================
+/** Time and resident memory to create and destroy a batch of processors, as a host
+    scanning or loading a large session does. None of them is ever prepared. */
+class InstantiationBenchmark  : public Benchmarks::Benchmark
+{
+public:
+    InstantiationBenchmark() : Benchmarks::Benchmark ("instantiation") {}
+
+    void run (Benchmarks::Runner& runner) override
+    {
+        const auto numRounds = runner.isQuick() ? 2 : 5;
+
+        std::vector<juce::int64> constructionTimes, destructionTimes;
+        juce::int64 residentBytesPerInstance = 0;
+
+        for (int round = 0; round < numRounds; ++round)
+        {
+            std::vector<std::unique_ptr<SimpleSamplerAudioProcessor>> processors;
+            processors.reserve ((size_t) numInstances);
+
+            const auto residentBefore = getResidentBytes();
+            auto start = juce::Time::getHighResolutionTicks();
+
+            for (int i = 0; i < numInstances; ++i)
+                processors.push_back (std::make_unique<SimpleSamplerAudioProcessor>());
+
+            constructionTimes.push_back (juce::Time::getHighResolutionTicks() - start);
+
+            // Later rounds reuse memory the allocator kept from the first, so only the
+            // first round measures what the instances really cost
+            if (round == 0)
+                residentBytesPerInstance = (getResidentBytes() - residentBefore) / numInstances;
+
+            start = juce::Time::getHighResolutionTicks();
+            processors.clear();
+            destructionTimes.push_back (juce::Time::getHighResolutionTicks() - start);
+        }
+
+        juce::NamedValueSet parameters;
+        parameters.set ("instances", numInstances);
+        parameters.set ("residentBytesPerInstance", residentBytesPerInstance);
+
+        runner.addResult ("construct " + juce::String (numInstances) + " instances", parameters, numInstances, constructionTimes);
+        runner.addResult ("destroy " + juce::String (numInstances) + " instances", parameters, numInstances, destructionTimes);
+    }
+
+private:
+    static constexpr int numInstances = 100;
+
+    /** Resident memory of the whole process, or 0 where it can't be read. */
+    static juce::int64 getResidentBytes()
+    {
+       #if JUCE_MAC
+        mach_task_basic_info info;
+        mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+
+        if (task_info (mach_task_self(), MACH_TASK_BASIC_INFO, (task_info_t) &info, &count) == KERN_SUCCESS)
+            return (juce::int64) info.resident_size;
+       #elif JUCE_WINDOWS
+        PROCESS_MEMORY_COUNTERS counters;
+
+        if (GetProcessMemoryInfo (GetCurrentProcess(), &counters, sizeof (counters)))
+            return (juce::int64) counters.WorkingSetSize;
+       #elif JUCE_LINUX
+        // The second field is the resident set, in pages
+        juce::StringArray fields;
+        fields.addTokens (juce::File ("/proc/self/statm").loadFileAsString(), false);
+
+        if (fields.size() > 1)
+            return fields[1].getLargeIntValue() * (juce::int64) sysconf (_SC_PAGESIZE);
+       #endif
+
+        return 0;
+    }
+};
+
+static InstantiationBenchmark instantiationBenchmark;
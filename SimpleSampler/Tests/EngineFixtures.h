@@ -0,0 +1,100 @@
+/*
+  ==============================================================================
+
+    SimpleSampler - WAV Sampler Plugin with Virtual Keyboard
+    EngineFixtures.h - Processors, samples and MIDI for the engine tests
+
+    The engine tests and benchmarks drive a whole processor headlessly, as
+    the batch renderer does: load a sample, prepare, then call processBlock
+    with MIDI built here.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "../Source/PluginProcessor.h"
+#include "KernelCases.h"
+
+namespace EngineFixtures
+{
+    /** A two second stereo noise note with a decaying envelope, written once per run to
+        a temporary WAV file. */
+    inline juce::File getTestSampleFile()
+    {
+        static const juce::TemporaryFile temporaryFile (".wav");
+        static const auto file = []
+        {
+            constexpr int length = 96000;
+
+            auto audio = KernelCases::makeNoise (2, length, 5u);
+
+            for (int ch = 0; ch < 2; ++ch)
+                for (int i = 0; i < length; ++i)
+                    audio.getWritePointer (ch)[i] *= std::exp (-3.0f * (float) i / (float) length);
+
+            const auto target = temporaryFile.getFile();
+            target.deleteFile();
+
+            std::unique_ptr<juce::OutputStream> outputStream (target.createOutputStream());
+            std::unique_ptr<juce::AudioFormatWriter> writer;
+
+            if (outputStream != nullptr)
+                writer.reset (juce::WavAudioFormat().createWriterFor (outputStream.get(), 48000.0, 2, 24, {}, 0));
+
+            if (writer != nullptr)
+            {
+                outputStream.release();     // Now owned by the writer
+                writer->writeFromAudioSampleBuffer (audio, 0, length);
+            }
+
+            return target;
+        }();
+
+        return file;
+    }
+
+    /** Sets a parameter in its own units, as the batch renderer's job lists do. */
+    inline void setParameter (SimpleSamplerAudioProcessor& processor, const juce::String& parameterID, float value)
+    {
+        if (auto* parameter = processor.getValueTreeState().getParameter (parameterID))
+            parameter->setValueNotifyingHost (parameter->convertTo0to1 (value));
+        else
+            jassertfalse;
+    }
+
+    /** Loads the test sample and prepares the processor for playback. */
+    inline bool prepare (SimpleSamplerAudioProcessor& processor, double sampleRate, int blockSize)
+    {
+        if (! processor.loadSample (getTestSampleFile()))
+            return false;
+
+        processor.setRateAndBufferSizeDetails (sampleRate, blockSize);
+        processor.prepareToPlay (sampleRate, blockSize);
+        return true;
+    }
+
+    /** Fills midi with numEvents events spread over the block: note-ons and note-offs over
+        four octaves, with a controller and pitch bend mixed in. */
+    inline void addMidiFlood (juce::MidiBuffer& midi, int numEvents, int blockSize, juce::uint32 seed)
+    {
+        auto state = seed;
+
+        for (int i = 0; i < numEvents; ++i)
+        {
+            state = state * 1664525u + 1013904223u;
+            const auto note = 36 + (int) ((state >> 8) % 48u);
+            const auto position = (int) ((juce::int64) i * blockSize / juce::jmax (1, numEvents));
+
+            switch ((state >> 20) % 8u)
+            {
+                case 0:  midi.addEvent (juce::MidiMessage::controllerEvent (1, 1, (int) ((state >> 4) % 128u)), position); break;
+                case 1:  midi.addEvent (juce::MidiMessage::pitchWheel (1, (int) ((state >> 4) % 16384u)), position); break;
+                case 2:
+                case 3:
+                case 4:  midi.addEvent (juce::MidiMessage::noteOff (1, note), position); break;
+                default: midi.addEvent (juce::MidiMessage::noteOn (1, note, (juce::uint8) (40 + (state >> 12) % 80u)), position); break;
+            }
+        }
+    }
+}
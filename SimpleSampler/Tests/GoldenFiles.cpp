@@ -0,0 +1,88 @@
+/*
+  ==============================================================================
+
+    SimpleSampler - WAV Sampler Plugin with Virtual Keyboard
+    GoldenFiles.cpp - Stored reference renders for the regression tests
+
+  ==============================================================================
+*/
+
+#include "GoldenFiles.h"
+
+namespace GoldenFiles
+{
+    //==============================================================================
+    static juce::File directory { SIMPLESAMPLER_GOLDEN_DIR };
+    static bool updating = false;
+    static float tolerance = 1.0e-4f;
+
+    void setDirectory (const juce::File& newDirectory)     { directory = newDirectory; }
+    juce::File getDirectory()                               { return directory; }
+    void setUpdating (bool shouldUpdate)                    { updating = shouldUpdate; }
+    void setTolerance (float newTolerance)                  { tolerance = newTolerance; }
+
+    //==============================================================================
+    static juce::String write (const juce::File& file, const juce::AudioBuffer<float>& rendered)
+    {
+        file.getParentDirectory().createDirectory();
+        file.deleteFile();
+
+        std::unique_ptr<juce::OutputStream> outputStream (file.createOutputStream());
+        std::unique_ptr<juce::AudioFormatWriter> writer;
+
+        if (outputStream != nullptr)
+            writer.reset (juce::WavAudioFormat().createWriterFor (outputStream.get(), 48000.0,
+                                                                  (unsigned int) rendered.getNumChannels(), 32, {}, 0));
+
+        if (writer == nullptr)
+            return "could not write " + file.getFullPathName();
+
+        outputStream.release();     // Now owned by the writer
+        writer->writeFromAudioSampleBuffer (rendered, 0, rendered.getNumSamples());
+        return {};
+    }
+
+    static juce::String read (const juce::File& file, juce::AudioBuffer<float>& golden)
+    {
+        std::unique_ptr<juce::AudioFormatReader> reader (juce::WavAudioFormat().createReaderFor (file.createInputStream().release(), true));
+
+        if (reader == nullptr)
+            return "missing golden file " + file.getFullPathName()
+                 + " (run with --update-golden on a trusted build to create it, then review and commit it)";
+
+        golden.setSize ((int) reader->numChannels, (int) reader->lengthInSamples);
+        reader->read (&golden, 0, golden.getNumSamples(), 0, true, true);
+        return {};
+    }
+
+    juce::String check (const juce::String& name, const juce::AudioBuffer<float>& rendered)
+    {
+        const auto file = directory.getChildFile (name + ".wav");
+
+        if (updating)
+            return write (file, rendered);
+
+        juce::AudioBuffer<float> golden;
+        const auto readError = read (file, golden);
+
+        if (readError.isNotEmpty())
+            return readError;
+
+        if (golden.getNumChannels() != rendered.getNumChannels() || golden.getNumSamples() != rendered.getNumSamples())
+            return name + ": rendered " + juce::String (rendered.getNumChannels()) + " x " + juce::String (rendered.getNumSamples())
+                 + " samples, golden has " + juce::String (golden.getNumChannels()) + " x " + juce::String (golden.getNumSamples());
+
+        for (int ch = 0; ch < rendered.getNumChannels(); ++ch)
+        {
+            const auto* expected = golden.getReadPointer (ch);
+            const auto* actual = rendered.getReadPointer (ch);
+
+            for (int i = 0; i < rendered.getNumSamples(); ++i)
+                if (! (std::abs (actual[i] - expected[i]) <= tolerance))    // Also catches NaN
+                    return name + ": channel " + juce::String (ch) + " sample " + juce::String (i) + " is "
+                         + juce::String (actual[i], 7) + ", golden " + juce::String (expected[i], 7);
+        }
+
+        return {};
+    }
+}
@@ -0,0 +1,36 @@
+/*
+  ==============================================================================
+
+    SimpleSampler - WAV Sampler Plugin with Virtual Keyboard
+    GoldenFiles.h - Stored reference renders for the regression tests
+
+    A golden file is a 32-bit float WAV named after its test case. Tests
+    compare their render against it sample by sample within a tolerance,
+    so an optimisation that changes the sound fails the run. After a
+    deliberate change to the sound, run the tests with --update-golden to
+    rewrite the files, and review the new ones like any other change.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+namespace GoldenFiles
+{
+    /** Where golden files are read from and written to; defaults to Tests/Golden. */
+    void setDirectory (const juce::File& directory);
+    juce::File getDirectory();
+
+    /** When set, check() writes every render as the new golden file instead of comparing. */
+    void setUpdating (bool shouldUpdate);
+
+    /** Largest allowed difference of any sample; small enough to catch any audible change,
+        large enough for vector code and maths libraries that round differently. */
+    void setTolerance (float newTolerance);
+
+    /** Compares a render with its golden file and returns a description of the first
+        mismatch, or an empty string if they match. */
+    juce::String check (const juce::String& name, const juce::AudioBuffer<float>& rendered);
+}
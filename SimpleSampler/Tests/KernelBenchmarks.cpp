@@ -0,0 +1,308 @@
+/*
+  ==============================================================================
+
+    SimpleSampler - WAV Sampler Plugin with Virtual Keyboard
+    KernelBenchmarks.cpp - Throughput of the voice kernels, envelope and reverb
+
+  ==============================================================================
+*/
+
+#include "Benchmarks.h"
+#include "KernelCases.h"
+#include "ReferenceKernel.h"
+
+//==============================================================================
+/** Renders a number of looping voices into one output block, as the synthesiser does. */
+class VoiceKernelBenchmark  : public Benchmarks::Benchmark
+{
+public:
+    VoiceKernelBenchmark() : Benchmarks::Benchmark ("voice_kernels") {}
+
+    void run (Benchmarks::Runner& runner) override
+    {
+        const auto source = KernelCases::makeNoise (2, sourceLength, 3u);
+
+        const auto voiceCounts = runner.isQuick() ? std::vector<int> { 8 } : std::vector<int> { 1, 8, 32 };
+        const auto blockSizes = runner.isQuick() ? std::vector<int> { 256 } : std::vector<int> { 64, 256, 1024 };
+
+        for (auto numSourceChannels : { 1, 2 })
+            for (auto interpolation : { VoiceKernels::Interpolation::linear, VoiceKernels::Interpolation::cubic })
+                for (auto pitchRatio : { 1.0, 1.7 })
+                    for (auto numVoices : voiceCounts)
+                        for (auto blockSize : blockSizes)
+                            measure (runner, source, numSourceChannels, interpolation, pitchRatio, numVoices, blockSize);
+    }
+
+private:
+    static constexpr int sourceLength = 48000;
+
+    static void measure (Benchmarks::Runner& runner, const juce::AudioBuffer<float>& source, int numSourceChannels,
+                         VoiceKernels::Interpolation interpolation, double pitchRatio, int numVoices, int blockSize)
+    {
+        juce::AudioBuffer<float> output (2, blockSize);
+        std::vector<float> envelope ((size_t) blockSize, 0.5f);
+        std::vector<VoiceKernels::RenderContext> voices ((size_t) numVoices);
+
+        for (size_t i = 0; i < voices.size(); ++i)
+        {
+            auto& context = voices[i];
+            context.inL = source.getReadPointer (0);
+            context.inR = numSourceChannels > 1 ? source.getReadPointer (1) : nullptr;
+            context.position = (double) (i * 997 % (size_t) sourceLength);
+            context.increment = pitchRatio;
+            context.endPosition = (double) sourceLength;
+            context.loopStart = 0.0;
+            context.loopEnd = (double) sourceLength;
+            context.gainL = 0.7f;
+            context.gainR = 0.7f;
+        }
+
+        const auto kernel = VoiceKernels::getKernel (numSourceChannels, 2, interpolation, VoiceKernels::LoopMode::forward);
+
+        juce::NamedValueSet parameters;
+        parameters.set ("sourceChannels", numSourceChannels);
+        parameters.set ("interpolation", interpolation == VoiceKernels::Interpolation::cubic ? "cubic" : "linear");
+        parameters.set ("pitchRatio", pitchRatio);
+        parameters.set ("voices", numVoices);
+        parameters.set ("blockSize", blockSize);
+
+        const auto caseName = juce::String (numSourceChannels == 2 ? "stereo" : "mono")
+                        + (interpolation == VoiceKernels::Interpolation::cubic ? " cubic" : " linear")
+                        + " x" + juce::String (pitchRatio, 1) + ", " + juce::String (numVoices) + " voices, "
+                        + juce::String (blockSize) + " samples";
+
+        // Items are voice-samples, so nsPerItem is the cost of one voice for one sample
+        runner.measure (caseName, parameters, (double) numVoices * blockSize, [&]
+        {
+            output.clear();
+
+            for (auto& context : voices)
+            {
+                context.outL = output.getWritePointer (0);
+                context.outR = output.getWritePointer (1);
+                context.envelope = envelope.data();
+                kernel (context, blockSize);
+            }
+        });
+    }
+};
+
+static VoiceKernelBenchmark voiceKernelBenchmark;
+
+//==============================================================================
+/** The specialised kernels against the branching loop they replaced, on the same voices. */
+class KernelSpecialisationBenchmark  : public Benchmarks::Benchmark
+{
+public:
+    KernelSpecialisationBenchmark() : Benchmarks::Benchmark ("kernel_specialisation") {}
+
+    void run (Benchmarks::Runner& runner) override
+    {
+        const auto source = KernelCases::makeNoise (2, sourceLength, 6u);
+
+        for (auto numSourceChannels : { 1, 2 })
+            for (auto numOutputChannels : { 1, 2 })
+                for (auto interpolation : { VoiceKernels::Interpolation::linear, VoiceKernels::Interpolation::cubic })
+                    for (auto loopMode : { VoiceKernels::LoopMode::oneShot, VoiceKernels::LoopMode::forward })
+                        for (auto specialised : { false, true })
+                            measure (runner, source, numSourceChannels, numOutputChannels, interpolation, loopMode, specialised);
+    }
+
+private:
+    static constexpr int sourceLength = 48000, numVoices = 8, blockSize = 256;
+    static constexpr double pitchRatio = 1.3;
+
+    static void measure (Benchmarks::Runner& runner, const juce::AudioBuffer<float>& source, int numSourceChannels,
+                         int numOutputChannels, VoiceKernels::Interpolation interpolation, VoiceKernels::LoopMode loopMode,
+                         bool specialised)
+    {
+        juce::AudioBuffer<float> output (numOutputChannels, blockSize);
+        std::vector<float> envelope ((size_t) blockSize, 0.5f);
+        std::vector<VoiceKernels::RenderContext> voices ((size_t) numVoices);
+
+        // Short loops, so the looping cases cross the seam every few blocks
+        for (size_t i = 0; i < voices.size(); ++i)
+        {
+            auto& context = voices[i];
+            context.inL = source.getReadPointer (0);
+            context.inR = numSourceChannels > 1 ? source.getReadPointer (1) : nullptr;
+            context.increment = pitchRatio;
+            context.endPosition = (double) sourceLength;
+            context.loopStart = (double) (i * 1000);
+            context.loopEnd = context.loopStart + 777.0;
+            context.position = context.loopStart;
+            context.gainL = 0.7f;
+            context.gainR = 0.7f;
+        }
+
+        const auto kernel = VoiceKernels::getKernel (numSourceChannels, numOutputChannels, interpolation, loopMode);
+        const auto looping = loopMode == VoiceKernels::LoopMode::forward;
+
+        juce::NamedValueSet parameters;
+        parameters.set ("implementation", specialised ? "specialised" : "branching");
+        parameters.set ("sourceChannels", numSourceChannels);
+        parameters.set ("outputChannels", numOutputChannels);
+        parameters.set ("interpolation", interpolation == VoiceKernels::Interpolation::cubic ? "cubic" : "linear");
+        parameters.set ("loopMode", looping ? "forward" : "oneShot");
+        parameters.set ("voices", numVoices);
+        parameters.set ("blockSize", blockSize);
+
+        const auto caseName = juce::String (specialised ? "specialised " : "branching ")
+                        + juce::String (numSourceChannels) + " to " + juce::String (numOutputChannels) + " ch"
+                        + (interpolation == VoiceKernels::Interpolation::cubic ? " cubic" : " linear")
+                        + (looping ? " loop" : " one-shot");
+
+        runner.measure (caseName, parameters, (double) numVoices * blockSize, [&]
+        {
+            output.clear();
+
+            for (auto& context : voices)
+            {
+                // One-shots restart as they run out, so every call renders full blocks
+                if (! looping && context.position > (double) (sourceLength - 2 * blockSize))
+                    context.position = context.loopStart;
+
+                context.outL = output.getWritePointer (0);
+                context.outR = numOutputChannels > 1 ? output.getWritePointer (1) : nullptr;
+                context.envelope = envelope.data();
+
+                if (specialised)
+                    kernel (context, blockSize);
+                else
+                    ReferenceKernel::render (context, blockSize, interpolation, loopMode);
+            }
+        });
+    }
+};
+
+static KernelSpecialisationBenchmark kernelSpecialisationBenchmark;
+
+//==============================================================================
+/** Renders a note's envelope through attack, decay and release, block by block. */
+class EnvelopeBenchmark  : public Benchmarks::Benchmark
+{
+public:
+    EnvelopeBenchmark() : Benchmarks::Benchmark ("envelope") {}
+
+    void run (Benchmarks::Runner& runner) override
+    {
+        const auto blockSizes = runner.isQuick() ? std::vector<int> { 256 } : std::vector<int> { 64, 256, 1024 };
+
+        for (auto curve : { 0.0f, 0.5f, 1.0f })
+        {
+            for (auto blockSize : blockSizes)
+            {
+                EnvelopeGenerator envelope;
+                envelope.setSampleRate (48000.0);
+
+                EnvelopeGenerator::Parameters envelopeParameters;
+                envelopeParameters.attack = 0.005f;
+                envelopeParameters.decay = 0.01f;
+                envelopeParameters.sustain = 0.5f;
+                envelopeParameters.release = 0.01f;
+                envelopeParameters.curve = curve;
+                envelope.setParameters (envelopeParameters);
+
+                // Short segments, so every call crosses several segment boundaries
+                constexpr int noteLength = 1920;
+                std::vector<float> block ((size_t) blockSize);
+
+                juce::NamedValueSet parameters;
+                parameters.set ("curve", curve);
+                parameters.set ("blockSize", blockSize);
+
+                runner.measure ("curve " + juce::String (curve, 1) + ", " + juce::String (blockSize) + " samples",
+                                parameters, (double) noteLength, [&]
+                {
+                    envelope.noteOn();
+
+                    for (int i = 0; i < noteLength; i += blockSize)
+                    {
+                        if (i >= noteLength / 2 && i < noteLength / 2 + blockSize)
+                            envelope.noteOff();
+
+                        envelope.render (block.data(), blockSize);
+                    }
+
+                    envelope.reset();
+                });
+            }
+        }
+    }
+};
+
+static EnvelopeBenchmark envelopeBenchmark;
+
+//==============================================================================
+/** Processes stereo noise through the reverb, and through juce::dsp::Reverb at the same
+    setting as a baseline. */
+class ReverbBenchmark  : public Benchmarks::Benchmark
+{
+public:
+    ReverbBenchmark() : Benchmarks::Benchmark ("reverb") {}
+
+    void run (Benchmarks::Runner& runner) override
+    {
+        const auto blockSizes = runner.isQuick() ? std::vector<int> { 256 } : std::vector<int> { 64, 256, 1024 };
+
+        for (const auto& reverbCase : KernelCases::getReverbCases())
+        {
+            for (auto blockSize : blockSizes)
+            {
+                const auto input = KernelCases::makeNoise (2, blockSize, 4u);
+                juce::AudioBuffer<float> buffer (2, blockSize);
+
+                FdnReverb reverb;
+                reverb.prepare (48000.0, blockSize);
+                reverb.setParameters (reverbCase.parameters);
+                reverb.reset();
+
+                juce::dsp::Reverb baseline;
+                baseline.prepare ({ 48000.0, (juce::uint32) blockSize, 2 });
+                baseline.setParameters (getBaselineParameters (reverbCase.parameters));
+
+                for (auto implementation : { "fdn", "juce_dsp" })
+                {
+                    const auto isBaseline = juce::String (implementation) == "juce_dsp";
+
+                    juce::NamedValueSet parameters;
+                    parameters.set ("implementation", implementation);
+                    parameters.set ("setting", reverbCase.name);
+                    parameters.set ("blockSize", blockSize);
+
+                    runner.measure (juce::String (implementation) + ", " + reverbCase.name + ", " + juce::String (blockSize) + " samples",
+                                    parameters, (double) blockSize, [&]
+                    {
+                        for (int ch = 0; ch < 2; ++ch)
+                            buffer.copyFrom (ch, 0, input, ch, 0, blockSize);
+
+                        if (isBaseline)
+                        {
+                            juce::dsp::AudioBlock<float> block (buffer);
+                            baseline.process (juce::dsp::ProcessContextReplacing<float> (block));
+                        }
+                        else
+                        {
+                            reverb.process (buffer);
+                        }
+                    });
+                }
+            }
+        }
+    }
+
+private:
+    /** The nearest juce::Reverb setting; it has no pre-delay. */
+    static juce::dsp::Reverb::Parameters getBaselineParameters (const FdnReverb::Parameters& fdn)
+    {
+        juce::dsp::Reverb::Parameters parameters;
+        parameters.roomSize = fdn.roomSize;
+        parameters.damping = fdn.damping;
+        parameters.wetLevel = fdn.wetLevel;
+        parameters.dryLevel = fdn.dryLevel;
+        parameters.width = fdn.width;
+        return parameters;
+    }
+};
+
+static ReverbBenchmark reverbBenchmark;
@@ -0,0 +1,251 @@
+/*
+  ==============================================================================
+
+    SimpleSampler - WAV Sampler Plugin with Virtual Keyboard
+    KernelCases.h - Fixed inputs and renders for the DSP kernel tests
+
+    Each case drives one kernel on its own - the voice render kernels, the
+    envelope or the reverb - with inputs built from an integer noise
+    generator, so a case renders the same samples on every platform up to
+    the rounding of the reverb's coefficients. The golden buffers in
+    Tests/Golden are these renders, stored as 32-bit float WAV files.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "../Source/VoiceKernels.h"
+#include "../Source/EnvelopeGenerator.h"
+#include "../Source/FdnReverb.h"
+
+namespace KernelCases
+{
+    // Zeroed samples after the end of a source, as SampleData keeps them
+    static constexpr int guardSamples = 4;
+
+    /** Lowpassed white noise from a linear congruential generator. */
+    inline juce::AudioBuffer<float> makeNoise (int numChannels, int numSamples, juce::uint32 seed)
+    {
+        juce::AudioBuffer<float> noise (numChannels, numSamples + guardSamples);
+
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            auto* data = noise.getWritePointer (ch);
+            auto state = seed + (juce::uint32) ch * 7919u;
+            auto smoothed = 0.0f;
+
+            for (int i = 0; i < numSamples; ++i)
+            {
+                state = state * 1664525u + 1013904223u;
+                const auto white = (float) ((state >> 8) & 0xffff) / 32768.0f - 1.0f;
+                smoothed += 0.3f * (white - smoothed);
+                data[i] = smoothed;
+            }
+
+            for (int i = numSamples; i < numSamples + guardSamples; ++i)
+                data[i] = 0.0f;
+        }
+
+        return noise;
+    }
+
+    //==============================================================================
+    /** One voice kernel instantiation playing a noise source at a fixed pitch. */
+    struct VoiceCase
+    {
+        int numSourceChannels = 1;
+        int numOutputChannels = 1;
+        VoiceKernels::Interpolation interpolation = VoiceKernels::Interpolation::linear;
+        VoiceKernels::LoopMode loopMode = VoiceKernels::LoopMode::oneShot;
+        double pitchRatio = 1.0;
+
+        juce::String getName() const
+        {
+            juce::String name ("voice_");
+            name << (numSourceChannels == 2 ? "stereo" : "mono") << "_to_" << (numOutputChannels == 2 ? "stereo" : "mono")
+                 << (interpolation == VoiceKernels::Interpolation::cubic ? "_cubic" : "_linear")
+                 << (loopMode == VoiceKernels::LoopMode::forward ? "_loop" : "_oneshot")
+                 << "_x" << juce::String (pitchRatio, 2);
+            return name;
+        }
+    };
+
+    static constexpr int voiceSourceLength = 1024;
+    static constexpr int voiceRenderLength = 512;
+
+    // A short loop, so every pitch ratio crosses the seam several times
+    static constexpr int voiceLoopStart = 64, voiceLoopEnd = 192;
+
+    // One-shots start late enough that the faster ones run off the end
+    static constexpr double voiceOneShotStart = 600.0, voiceLoopedStart = 16.0;
+
+    inline std::vector<VoiceCase> getVoiceCases()
+    {
+        std::vector<VoiceCase> cases;
+
+        for (int numSourceChannels = 1; numSourceChannels <= 2; ++numSourceChannels)
+            for (int numOutputChannels = 1; numOutputChannels <= 2; ++numOutputChannels)
+                for (auto interpolation : { VoiceKernels::Interpolation::linear, VoiceKernels::Interpolation::cubic })
+                    for (auto loopMode : { VoiceKernels::LoopMode::oneShot, VoiceKernels::LoopMode::forward })
+                        for (auto pitchRatio : { 0.5, 1.0, 1.7, 3.1 })
+                            cases.push_back ({ numSourceChannels, numOutputChannels, interpolation, loopMode, pitchRatio });
+
+        return cases;
+    }
+
+    using VoiceRenderFunction = std::function<int (VoiceKernels::RenderContext&, int numSamples)>;
+
+    /** Renders a case in uneven chunks, so runs also break at chunk boundaries. By default
+        the case's own kernel renders it; renderFunction replaces that. */
+    inline juce::AudioBuffer<float> renderVoiceCase (const VoiceCase& voiceCase, VoiceRenderFunction renderFunction = {})
+    {
+        const auto source = makeNoise (voiceCase.numSourceChannels, voiceSourceLength, 1u);
+
+        juce::AudioBuffer<float> output (voiceCase.numOutputChannels, voiceRenderLength);
+
+        for (int ch = 0; ch < voiceCase.numOutputChannels; ++ch)
+            juce::FloatVectorOperations::clear (output.getWritePointer (ch), voiceRenderLength);
+
+        std::vector<float> envelope ((size_t) voiceRenderLength);
+
+        for (int i = 0; i < voiceRenderLength; ++i)
+            envelope[(size_t) i] = 0.25f + 0.75f * (float) i / (float) voiceRenderLength;
+
+        const auto looping = voiceCase.loopMode == VoiceKernels::LoopMode::forward;
+
+        VoiceKernels::RenderContext context;
+        context.inL = source.getReadPointer (0);
+        context.inR = voiceCase.numSourceChannels > 1 ? source.getReadPointer (1) : nullptr;
+        context.outL = output.getWritePointer (0);
+        context.outR = voiceCase.numOutputChannels > 1 ? output.getWritePointer (1) : nullptr;
+        context.envelope = envelope.data();
+        context.position = looping ? voiceLoopedStart : voiceOneShotStart;
+        context.increment = voiceCase.pitchRatio;
+        context.endPosition = (double) voiceSourceLength;
+        context.loopStart = voiceLoopStart;
+        context.loopEnd = voiceLoopEnd;
+        context.gainL = 0.8f;
+        context.gainR = 0.6f;
+
+        if (renderFunction == nullptr)
+            renderFunction = VoiceKernels::getKernel (voiceCase.numSourceChannels, voiceCase.numOutputChannels,
+                                                      voiceCase.interpolation, voiceCase.loopMode);
+        int numDone = 0;
+
+        while (numDone < voiceRenderLength && ! (! looping && context.isFinished()))
+        {
+            const auto numWritten = renderFunction (context, juce::jmin (100, voiceRenderLength - numDone));
+            context.envelope += numWritten;
+            numDone += numWritten;
+        }
+
+        return output;
+    }
+
+    //==============================================================================
+    /** A full note through the envelope: attack, decay, sustain, then release. */
+    struct EnvelopeCase
+    {
+        float curve = 0.5f;
+
+        juce::String getName() const    { return "envelope_curve" + juce::String (curve, 2); }
+    };
+
+    inline std::vector<EnvelopeCase> getEnvelopeCases()
+    {
+        return { { 0.0f }, { 0.5f }, { 1.0f } };
+    }
+
+    inline juce::AudioBuffer<float> renderEnvelopeCase (const EnvelopeCase& envelopeCase)
+    {
+        constexpr int halfLength = 2400, blockSize = 48;
+
+        EnvelopeGenerator envelope;
+        envelope.setSampleRate (48000.0);
+
+        EnvelopeGenerator::Parameters parameters;
+        parameters.attack = 0.01f;
+        parameters.decay = 0.02f;
+        parameters.sustain = 0.6f;
+        parameters.release = 0.03f;
+        parameters.curve = envelopeCase.curve;
+        envelope.setParameters (parameters);
+
+        juce::AudioBuffer<float> output (1, 2 * halfLength);
+        auto* data = output.getWritePointer (0);
+
+        envelope.noteOn();
+
+        for (int i = 0; i < 2 * halfLength; i += blockSize)
+        {
+            if (i == halfLength)
+                envelope.noteOff();
+
+            envelope.render (data + i, blockSize);
+        }
+
+        return output;
+    }
+
+    //==============================================================================
+    /** The reverb fed an impulse on the left and a noise burst on the right. */
+    struct ReverbCase
+    {
+        const char* name;
+        FdnReverb::Parameters parameters;
+
+        juce::String getName() const    { return juce::String ("reverb_") + name; }
+    };
+
+    inline std::vector<ReverbCase> getReverbCases()
+    {
+        FdnReverb::Parameters small;
+        small.roomSize = 0.2f;
+        small.damping = 0.3f;
+        small.wetLevel = 1.0f;
+        small.dryLevel = 0.0f;
+
+        FdnReverb::Parameters large;
+        large.roomSize = 0.8f;
+        large.damping = 0.7f;
+        large.preDelayMs = 20.0f;
+        large.width = 0.5f;
+        large.wetLevel = 0.5f;
+        large.dryLevel = 0.5f;
+
+        return { { "small_wet", small }, { "large_mixed", large } };
+    }
+
+    inline juce::AudioBuffer<float> renderReverbCase (const ReverbCase& reverbCase)
+    {
+        constexpr int length = 8192, blockSize = 512;
+
+        const auto noise = makeNoise (1, length, 2u);
+        juce::AudioBuffer<float> buffer (2, length);
+
+        for (int ch = 0; ch < 2; ++ch)
+            juce::FloatVectorOperations::clear (buffer.getWritePointer (ch), length);
+
+        buffer.getWritePointer (0)[0] = 1.0f;
+        juce::FloatVectorOperations::copy (buffer.getWritePointer (1) + 1000, noise.getReadPointer (0), 200);
+
+        FdnReverb reverb;
+        reverb.prepare (48000.0, blockSize);
+        reverb.setParameters (reverbCase.parameters);
+        reverb.reset();     // Start at the setting instead of ramping to it
+
+        std::array<float*, 2> channels;
+        juce::AudioBuffer<float> block;
+
+        for (int start = 0; start < length; start += blockSize)
+        {
+            channels = { buffer.getWritePointer (0, start), buffer.getWritePointer (1, start) };
+            block.setDataToReferTo (channels.data(), 2, blockSize);
+            reverb.process (block);
+        }
+
+        return buffer;
+    }
+}
@@ -0,0 +1,261 @@
+/*
+  ==============================================================================
+
+    SimpleSampler - WAV Sampler Plugin with Virtual Keyboard
+    KernelTests.cpp - Golden and property tests for the DSP kernels
+
+  ==============================================================================
+*/
+
+#include "KernelCases.h"
+#include "GoldenFiles.h"
+#include "ReferenceKernel.h"
+#include "../Source/GranularStretcher.h"
+
+//==============================================================================
+class VoiceKernelTests  : public juce::UnitTest
+{
+public:
+    VoiceKernelTests() : juce::UnitTest ("Voice kernels", "SimpleSampler") {}
+
+    void runTest() override
+    {
+        beginTest ("Every kernel matches its golden render");
+
+        for (const auto& voiceCase : KernelCases::getVoiceCases())
+        {
+            const auto error = GoldenFiles::check (voiceCase.getName(), KernelCases::renderVoiceCase (voiceCase));
+            expect (error.isEmpty(), error);
+        }
+
+        beginTest ("Every kernel renders the same samples as the branching reference loop");
+
+        for (const auto& voiceCase : KernelCases::getVoiceCases())
+        {
+            const auto reference = KernelCases::renderVoiceCase (voiceCase, [voiceCase] (VoiceKernels::RenderContext& context, int numSamples)
+            {
+                return ReferenceKernel::render (context, numSamples, voiceCase.interpolation, voiceCase.loopMode);
+            });
+
+            expectEquals (getMaxDifference (KernelCases::renderVoiceCase (voiceCase), reference), 0.0f, voiceCase.getName());
+        }
+
+        beginTest ("A loop whose ends meet plays through the seam without a step");
+
+        for (auto interpolation : { VoiceKernels::Interpolation::linear, VoiceKernels::Interpolation::cubic })
+            expectLessThan (getLoopSeamError (interpolation), 1.0e-3f);
+    }
+
+private:
+    static float getMaxDifference (const juce::AudioBuffer<float>& a, const juce::AudioBuffer<float>& b)
+    {
+        auto maxDifference = 0.0f;
+
+        for (int ch = 0; ch < a.getNumChannels(); ++ch)
+            for (int i = 0; i < a.getNumSamples(); ++i)
+                maxDifference = juce::jmax (maxDifference, std::abs (a.getSample (ch, i) - b.getSample (ch, i)));
+
+        return maxDifference;
+    }
+
+    /** Loops exactly one period of a cosine, which is at its peak where the loop end meets
+        the loop start, and returns the largest difference from the ideal cosine. */
+    static float getLoopSeamError (VoiceKernels::Interpolation interpolation)
+    {
+        constexpr int loopStart = 100, loopLength = 256, sourceLength = 1024, numSamples = 2048;
+        constexpr double increment = 0.73;
+
+        std::vector<float> source ((size_t) sourceLength + KernelCases::guardSamples, 0.0f);
+
+        // Past the loop end the source drops to zero, so any tap read there shows up
+        for (int i = 0; i < loopStart + loopLength; ++i)
+            source[(size_t) i] = std::cos (juce::MathConstants<float>::twoPi * (float) (i - loopStart) / (float) loopLength);
+
+        std::vector<float> output ((size_t) numSamples, 0.0f), envelope ((size_t) numSamples, 1.0f);
+
+        VoiceKernels::RenderContext context;
+        context.inL = source.data();
+        context.outL = output.data();
+        context.envelope = envelope.data();
+        context.position = (double) loopStart;
+        context.increment = increment;
+        context.endPosition = (double) sourceLength;
+        context.loopStart = loopStart;
+        context.loopEnd = loopStart + loopLength;
+        context.gainL = 1.0f;
+        context.gainR = 1.0f;
+
+        VoiceKernels::getKernel (1, 1, interpolation, VoiceKernels::LoopMode::forward) (context, numSamples);
+
+        auto maxError = 0.0f;
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            const auto phase = juce::MathConstants<double>::twoPi * increment * i / loopLength;
+            maxError = juce::jmax (maxError, std::abs (output[(size_t) i] - (float) std::cos (phase)));
+        }
+
+        return maxError;
+    }
+};
+
+static VoiceKernelTests voiceKernelTests;
+
+//==============================================================================
+class EnvelopeTests  : public juce::UnitTest
+{
+public:
+    EnvelopeTests() : juce::UnitTest ("Envelope", "SimpleSampler") {}
+
+    void runTest() override
+    {
+        beginTest ("Every curve matches its golden render");
+
+        for (const auto& envelopeCase : KernelCases::getEnvelopeCases())
+        {
+            const auto error = GoldenFiles::check (envelopeCase.getName(), KernelCases::renderEnvelopeCase (envelopeCase));
+            expect (error.isEmpty(), error);
+        }
+
+        beginTest ("A long linear attack at a high sample rate takes its full time");
+
+        constexpr double sampleRate = 768000.0;
+        constexpr float attackSeconds = 10.0f;
+
+        EnvelopeGenerator envelope;
+        envelope.setSampleRate (sampleRate);
+
+        EnvelopeGenerator::Parameters parameters;
+        parameters.attack = attackSeconds;
+        parameters.sustain = 1.0f;
+        parameters.curve = 0.0f;
+        envelope.setParameters (parameters);
+        envelope.noteOn();
+
+        std::vector<float> block (4096);
+        juce::int64 samplesToPeak = 0;
+        auto peaked = false;
+
+        while (! peaked && samplesToPeak < (juce::int64) (2.0 * attackSeconds * sampleRate))
+        {
+            envelope.render (block.data(), (int) block.size());
+
+            for (auto value : block)
+            {
+                ++samplesToPeak;
+
+                if (value >= 1.0f)
+                {
+                    peaked = true;
+                    break;
+                }
+            }
+        }
+
+        expect (peaked, "The attack never reached full level");
+        expectWithinAbsoluteError ((double) samplesToPeak / sampleRate, (double) attackSeconds, 0.01);
+    }
+};
+
+static EnvelopeTests envelopeTests;
+
+//==============================================================================
+class ReverbTests  : public juce::UnitTest
+{
+public:
+    ReverbTests() : juce::UnitTest ("Reverb", "SimpleSampler") {}
+
+    void runTest() override
+    {
+        beginTest ("Every setting matches its golden render");
+
+        for (const auto& reverbCase : KernelCases::getReverbCases())
+        {
+            const auto error = GoldenFiles::check (reverbCase.getName(), KernelCases::renderReverbCase (reverbCase));
+            expect (error.isEmpty(), error);
+        }
+
+        beginTest ("A level change ramps instead of jumping");
+        {
+            constexpr int blockSize = 480;
+
+            FdnReverb reverb;
+            reverb.prepare (48000.0, blockSize);
+
+            // Dry only, so the output is the input times the ramping dry level
+            FdnReverb::Parameters parameters;
+            reverb.setParameters (parameters);
+            reverb.reset();
+
+            juce::AudioBuffer<float> block (2, blockSize);
+            parameters.dryLevel = 0.0f;
+            reverb.setParameters (parameters);
+
+            float previous = 1.0f, largestStep = 0.0f;
+            bool falling = true;
+
+            // 50 ms of ramp is five blocks; the sixth is silent
+            for (int blockIndex = 0; blockIndex < 6; ++blockIndex)
+            {
+                for (int ch = 0; ch < 2; ++ch)
+                    juce::FloatVectorOperations::fill (block.getWritePointer (ch), 1.0f, blockSize);
+
+                reverb.process (block);
+
+                for (int n = 0; n < blockSize; ++n)
+                {
+                    const auto sample = block.getSample (0, n);
+                    falling = falling && sample <= previous;
+                    largestStep = juce::jmax (largestStep, previous - sample);
+                    previous = sample;
+                }
+            }
+
+            expect (falling);
+            expectLessThan (largestStep, 1.0e-3f);
+            expectEquals (previous, 0.0f);
+        }
+    }
+};
+
+static ReverbTests reverbTests;
+
+//==============================================================================
+class GranularStretcherTests  : public juce::UnitTest
+{
+public:
+    GranularStretcherTests() : juce::UnitTest ("Granular stretcher", "SimpleSampler") {}
+
+    void runTest() override
+    {
+        beginTest ("Overlapped grains of a constant source sum to unity from the first sample");
+
+        constexpr int sourceLength = 10000, numSamples = 8192, blockSize = 500;
+
+        std::vector<float> source ((size_t) sourceLength + KernelCases::guardSamples, 1.0f);
+
+        GranularStretcher::Source stretcherSource;
+        stretcherSource.inL = source.data();
+        stretcherSource.endPosition = (double) sourceLength;
+        stretcherSource.loopStart = 0.0;
+        stretcherSource.loopEnd = (double) sourceLength;
+        stretcherSource.looping = true;
+
+        GranularStretcher stretcher;
+        stretcher.start (0.0);
+
+        std::vector<float> output ((size_t) numSamples), scratch (2 * (size_t) blockSize);
+
+        for (int start = 0; start < numSamples; start += blockSize)
+        {
+            const auto num = juce::jmin (blockSize, numSamples - start);
+            stretcher.render (stretcherSource, 1.3, 0.6, output.data() + start, nullptr, scratch.data(), num);
+        }
+
+        const auto [minValue, maxValue] = std::minmax_element (output.begin(), output.end());
+        expectWithinAbsoluteError (*minValue, 1.0f, 1.0e-4f);
+        expectWithinAbsoluteError (*maxValue, 1.0f, 1.0e-4f);
+    }
+};
+
+static GranularStretcherTests granularStretcherTests;
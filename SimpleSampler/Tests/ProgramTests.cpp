@@ -0,0 +1,132 @@
+/*
+  ==============================================================================
+
+    SimpleSampler - WAV Sampler Plugin with Virtual Keyboard
+    ProgramTests.cpp - Kit files, program selection and saved state
+
+  ==============================================================================
+*/
+
+#include "EngineFixtures.h"
+
+//==============================================================================
+class ProgramTests  : public juce::UnitTest
+{
+public:
+    ProgramTests() : juce::UnitTest ("Kit files and programs", "SimpleSampler") {}
+
+    void runTest() override
+    {
+        // Quoted and escaped, so the path can go straight into the JSON below
+        const auto sample = juce::JSON::toString (EngineFixtures::getTestSampleFile().getFullPathName());
+
+        beginTest ("A bank file fills its programs");
+
+        const auto bankFile = writeKitFile (R"({ "programs": [
+            { "name": "First",  "zones": [ { "sample": )" + sample + R"( } ] },
+            { "name": "Second", "zones": [ { "sample": )" + sample + R"(, "lowNote": 36 },
+                                           { "sample": )" + sample + R"(, "lowNote": 48, "highNote": 60, "rootNote": 55 } ] },
+            { "name": "Fifth",  "program": 4, "zones": [ { "sample": )" + sample + R"( } ] } ] })");
+
+        SimpleSamplerAudioProcessor processor;
+        const auto result = processor.loadKitFile (bankFile->getFile());
+
+        expect (result.wasOk(), result.getErrorMessage());
+        expectEquals (processor.getNumPrograms(), 5);
+        expectEquals (processor.getProgramName (1), juce::String ("Second"));
+        expectEquals (processor.getProgramName (4), juce::String ("Fifth"));
+        expectEquals (getNumSounds (processor, 1), 2);
+
+        beginTest ("Selecting an empty program is ignored");
+
+        processor.setCurrentProgram (1);
+        expectEquals (processor.getCurrentProgram(), 1);
+        processor.setCurrentProgram (2);
+        expectEquals (processor.getCurrentProgram(), 1);
+
+        beginTest ("Saved state restores every kit and the current program");
+
+        juce::MemoryBlock state;
+        processor.getStateInformation (state);
+
+        SimpleSamplerAudioProcessor restored;
+        restored.setStateInformation (state.getData(), (int) state.getSize());
+
+        expect (! restored.didLastLoadFail());
+        expectEquals (restored.getNumPrograms(), 5);
+        expectEquals (restored.getCurrentProgram(), 1);
+
+        for (auto program : { 0, 1, 4 })
+        {
+            expectEquals (restored.getProgramName (program), processor.getProgramName (program));
+            expectEquals (getNumSounds (restored, program), getNumSounds (processor, program));
+        }
+
+        beginTest ("A zone routed to an aux output plays only there");
+
+        const auto routedKitFile = writeKitFile (R"({ "zones": [ { "sample": )" + sample + R"(, "outputBus": 2 } ] })");
+
+        SimpleSamplerAudioProcessor routed;
+        expect (routed.loadKitFile (routedKitFile->getFile()).wasOk());
+        expect (routed.enableAllBuses());
+
+        const auto levels = renderNote (routed);
+
+        for (int bus = 0; bus < (int) levels.size(); ++bus)
+            expect ((levels[(size_t) bus] > 0.0f) == (bus == 2), "Bus " + juce::String (bus) + " level " + juce::String (levels[(size_t) bus]));
+
+        beginTest ("A kit without zones is rejected");
+
+        const auto emptyKitFile = writeKitFile (R"({ "name": "Empty", "zones": [] })");
+        expect (processor.loadKitFile (emptyKitFile->getFile()).failed());
+    }
+
+private:
+    static std::unique_ptr<juce::TemporaryFile> writeKitFile (const juce::String& json)
+    {
+        auto file = std::make_unique<juce::TemporaryFile> (".json");
+        file->getFile().replaceWithText (json);
+        return file;
+    }
+
+    /** Plays one note and returns the peak level on each output bus. */
+    static std::vector<float> renderNote (SimpleSamplerAudioProcessor& processor)
+    {
+        constexpr double sampleRate = 48000.0;
+        constexpr int blockSize = 512;
+
+        processor.setRateAndBufferSizeDetails (sampleRate, blockSize);
+        processor.prepareToPlay (sampleRate, blockSize);
+
+        juce::AudioBuffer<float> buffer (processor.getTotalNumOutputChannels(), blockSize);
+        std::vector<float> levels ((size_t) processor.getBusCount (false), 0.0f);
+
+        for (int block = 0; block < 8; ++block)
+        {
+            juce::MidiBuffer midi;
+
+            if (block == 0)
+                midi.addEvent (juce::MidiMessage::noteOn (1, 60, (juce::uint8) 100), 0);
+
+            buffer.clear();
+            processor.processBlock (buffer, midi);
+
+            for (int bus = 0; bus < processor.getBusCount (false); ++bus)
+            {
+                const auto busBuffer = processor.getBusBuffer (buffer, false, bus);
+                levels[(size_t) bus] = juce::jmax (levels[(size_t) bus], busBuffer.getMagnitude (0, blockSize));
+            }
+        }
+
+        processor.releaseResources();
+        return levels;
+    }
+
+    static int getNumSounds (SimpleSamplerAudioProcessor& processor, int program)
+    {
+        auto* kit = processor.getProgramBank().getKit (program);
+        return kit != nullptr ? kit->getSounds().size() : 0;
+    }
+};
+
+static ProgramTests programTests;
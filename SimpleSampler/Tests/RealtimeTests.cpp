@@ -0,0 +1,124 @@
+/*
+  ==============================================================================
+
+    SimpleSampler - WAV Sampler Plugin with Virtual Keyboard
+    RealtimeTests.cpp - Headless processBlock run under the realtime checks
+
+    The test target is always built with SIMPLESAMPLER_REALTIME_CHECKS, so
+    any allocation, deallocation or contended lock inside processBlock is
+    counted, and every configuration below must add none to the count.
+
+  ==============================================================================
+*/
+
+#include "EngineFixtures.h"
+#include "../Source/RealtimeCheck.h"
+
+//==============================================================================
+class RealtimeSafetyTests  : public juce::UnitTest
+{
+public:
+    RealtimeSafetyTests() : juce::UnitTest ("processBlock realtime safety", "SimpleSampler") {}
+
+    void runTest() override
+    {
+        struct Configuration
+        {
+            const char* name;
+            std::vector<std::pair<const char*, float>> parameters;
+        };
+
+        const std::vector<Configuration> configurations
+        {
+            { "Default settings",             {} },
+            { "Cubic looping with reverb",    { { "interpolation", 1.0f }, { "loopMode", 1.0f }, { "reverb", 0.4f }, { "reverbPreDelay", 30.0f } } },
+            { "4x oversampling",              { { "oversampling", 2.0f } } },
+            { "Time stretch",                 { { "timeStretch", 1.0f }, { "stretchRate", 0.7f } } },
+            { "Note cache",                   { { "renderCache", 1.0f } } },
+            { "Legato with glide",            { { "playMode", 2.0f }, { "glide", 0.05f } } },
+            { "Normalised, from an onset",    { { "normalise", 1.0f }, { "startOnset", 1.0f } } }
+        };
+
+        for (const auto& configuration : configurations)
+        {
+            beginTest (configuration.name);
+
+            SimpleSamplerAudioProcessor processor;
+
+            for (const auto& [parameterID, value] : configuration.parameters)
+                EngineFixtures::setParameter (processor, parameterID, value);
+
+            expect (EngineFixtures::prepare (processor, sampleRate, blockSize), "Could not load the test sample");
+
+            // A second program, so the program changes below switch kits on the audio thread
+            SimpleSamplerAudioProcessor::SampleZone zone;
+            zone.notes.setRange (0, 128, true);
+
+            juce::Array<SimpleSamplerAudioProcessor::KitZone> zones;
+            zones.add ({ EngineFixtures::getTestSampleFile(), zone });
+            expect (processor.loadKit (1, "Second", zones), "Could not load the second program");
+
+            // The count is process-wide, so only what this configuration adds is checked
+            const auto violationsBefore = RealtimeCheck::getNumViolations();
+
+            render (processor);
+            processor.releaseResources();
+
+            expectEquals (RealtimeCheck::getNumViolations() - violationsBefore, 0);
+            expect (processor.getNumDroppedMidiEvents() > 0, "The oversized flood should have been cut short");
+        }
+    }
+
+private:
+    static constexpr double sampleRate = 48000.0;
+    static constexpr int blockSize = 256, numBlocks = 400;
+
+    /** Plays chords, the virtual keyboard, floods and program changes through processBlock.
+        One flood is bigger than the processor's MIDI scratch buffer, which must drop the
+        excess rather than grow. */
+    static void render (SimpleSamplerAudioProcessor& processor)
+    {
+        juce::AudioBuffer<float> buffer (processor.getTotalNumOutputChannels(), blockSize);
+        juce::MidiBuffer midi;
+
+        // Sized for the largest block up front, so only the processor can allocate below
+        midi.ensureSize (65536);
+
+        for (int block = 0; block < numBlocks; ++block)
+        {
+            midi.clear();
+
+            if (block % 8 == 0)
+                for (auto note : { 48, 55, 60, 64, 79, 96 })
+                    midi.addEvent (juce::MidiMessage::noteOn (1, note + block / 8 % 5, (juce::uint8) 100), block % 3 * 50);
+
+            if (block % 8 == 5)
+                for (auto note : { 48, 55, 60, 64, 79, 96 })
+                    midi.addEvent (juce::MidiMessage::noteOff (1, note + block / 8 % 5), 17);
+
+            if (block % 50 == 20)
+                EngineFixtures::addMidiFlood (midi, 600, blockSize, (juce::uint32) block);
+
+            if (block == 330)
+                EngineFixtures::addMidiFlood (midi, 6000, blockSize, (juce::uint32) block);
+
+            if (block == 150)
+                midi.addEvent (juce::MidiMessage::programChange (1, 1), 0);
+
+            if (block == 160)
+                midi.addEvent (juce::MidiMessage::programChange (1, 0), 0);
+
+            // The keyboard's FIFO is filled off the audio thread, as the editor does
+            if (block % 16 == 3)
+                processor.addNoteOn (72, 0.8f);
+
+            if (block % 16 == 11)
+                processor.addNoteOff (72);
+
+            buffer.clear();
+            processor.processBlock (buffer, midi);
+        }
+    }
+};
+
+static RealtimeSafetyTests realtimeSafetyTests;
@@ -0,0 +1,106 @@
+/*
+  ==============================================================================
+
+    SimpleSampler - WAV Sampler Plugin with Virtual Keyboard
+    ReferenceKernel.h - The branching voice loop the specialised kernels replaced
+
+    One loop for every layout and playback option, testing the channel
+    counts, interpolation, loop seam and end on every sample, as
+    SamplerVoice did before the kernels were specialised. It is kept only
+    as the baseline for the kernel benchmark and as an independent check
+    of the kernels' output.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "../Source/VoiceKernels.h"
+
+namespace ReferenceKernel
+{
+    inline int render (VoiceKernels::RenderContext& context, int numSamples,
+                       VoiceKernels::Interpolation interpolation, VoiceKernels::LoopMode loopMode) noexcept
+    {
+        using namespace VoiceKernels;
+
+        const auto* inL = context.inL;
+        const auto* inR = context.inR;
+        auto* outL = context.outL;
+        auto* outR = context.outR;
+        auto position = context.position;
+
+        const auto looping = loopMode == LoopMode::forward;
+        const auto cubic = interpolation == Interpolation::cubic;
+        const auto loopStart = (int) context.loopStart;
+        const auto loopEnd = (int) context.loopEnd;
+
+        int i = 0;
+
+        while (i < numSamples)
+        {
+            const auto pos = (int) position;
+            const auto alpha = (float) (position - pos);
+            const auto tapsAhead = cubic ? 2 : 1;
+
+            float l, r;
+
+            if (looping && pos + tapsAhead >= loopEnd)
+            {
+                l = cubic ? detail::interpolateAcrossLoopEnd<Interpolation::cubic> (inL, pos, alpha, loopStart, loopEnd)
+                          : detail::interpolateAcrossLoopEnd<Interpolation::linear> (inL, pos, alpha, loopStart, loopEnd);
+
+                if (inR != nullptr)
+                    r = cubic ? detail::interpolateAcrossLoopEnd<Interpolation::cubic> (inR, pos, alpha, loopStart, loopEnd)
+                              : detail::interpolateAcrossLoopEnd<Interpolation::linear> (inR, pos, alpha, loopStart, loopEnd);
+                else
+                    r = l;
+            }
+            else
+            {
+                l = cubic ? detail::interpolate<Interpolation::cubic> (inL, pos, alpha)
+                          : detail::interpolate<Interpolation::linear> (inL, pos, alpha);
+
+                if (inR != nullptr)
+                    r = cubic ? detail::interpolate<Interpolation::cubic> (inR, pos, alpha)
+                              : detail::interpolate<Interpolation::linear> (inR, pos, alpha);
+                else
+                    r = l;
+            }
+
+            const auto envelopeValue = context.envelope[i];
+
+            l = l * context.gainL * envelopeValue;
+            r = r * context.gainR * envelopeValue;
+
+            if (outR != nullptr)
+            {
+                *outL++ += l;
+                *outR++ += r;
+            }
+            else
+            {
+                *outL++ += (l + r) * 0.5f;
+            }
+
+            ++i;
+            position += context.increment;
+
+            if (looping)
+            {
+                if (position >= context.loopEnd)
+                    position = context.loopStart + std::fmod (position - context.loopStart,
+                                                              context.loopEnd - context.loopStart);
+            }
+            else if (position > context.endPosition)
+            {
+                break;
+            }
+        }
+
+        context.outL = outL;
+        context.outR = outR;
+        context.position = position;
+        return i;
+    }
+}
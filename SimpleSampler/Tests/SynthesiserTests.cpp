@@ -0,0 +1,206 @@
+/*
+  ==============================================================================
+
+    SimpleSampler - WAV Sampler Plugin with Virtual Keyboard
+    SynthesiserTests.cpp - Choke groups, retriggering and play modes
+
+  ==============================================================================
+*/
+
+#include "KernelCases.h"
+#include "../Source/SamplerSynthesiser.h"
+
+//==============================================================================
+class SynthesiserTests  : public juce::UnitTest
+{
+public:
+    SynthesiserTests() : juce::UnitTest ("Sampler synthesiser voices", "SimpleSampler") {}
+
+    void runTest() override
+    {
+        beginTest ("A hit in a choke group cuts off the rest of its group only");
+        {
+            Fixture fixture;
+            fixture.noteOn (openHat);
+            fixture.noteOn (kick);
+            fixture.noteOn (closedHat);
+
+            expectEquals (fixture.countVoices (openHat, releasing), 1);
+            expectEquals (fixture.countVoices (kick, releasing), 0);
+            expectEquals (fixture.countVoices (closedHat, releasing), 0);
+
+            // Past the choke fade, but well inside the release time
+            fixture.render (0.02);
+
+            expectEquals (fixture.countVoices (openHat, active), 0);
+            expectEquals (fixture.countVoices (kick, active), 1);
+            expectEquals (fixture.countVoices (closedHat, active), 1);
+
+            // The choked open hat left the group, so the next hit chokes only the closed hat
+            fixture.noteOn (openHat);
+            expectEquals (fixture.countVoices (closedHat, releasing), 1);
+            expectEquals (fixture.countVoices (openHat, releasing), 0);
+        }
+
+        beginTest ("Retriggering a note releases its ringing voice and starts another");
+        {
+            Fixture fixture;
+            fixture.noteOn (kick);
+            fixture.noteOn (kick);
+
+            expectEquals (fixture.countVoices (kick, active), 2);
+            expectEquals (fixture.countVoices (kick, releasing), 1);
+        }
+
+        beginTest ("A note-off only releases the voices of its own note");
+        {
+            Fixture fixture;
+            fixture.noteOn (60);
+            fixture.noteOn (62);
+            fixture.noteOff (62);
+
+            expectEquals (fixture.countVoices (62, releasing), 1);
+            expectEquals (fixture.countVoices (60, releasing), 0);
+        }
+
+        beginTest ("Finished voices go back to the free list");
+        {
+            Fixture fixture;
+
+            for (int round = 0; round < 3; ++round)
+            {
+                for (int i = 0; i < Fixture::numVoices; ++i)
+                    fixture.noteOn (60 + i);
+
+                // Every note found a free voice, so none was stolen
+                for (int i = 0; i < Fixture::numVoices; ++i)
+                    expectEquals (fixture.countVoices (60 + i, held), 1);
+
+                for (int i = 0; i < Fixture::numVoices; ++i)
+                    fixture.noteOff (60 + i);
+
+                fixture.render (0.3);
+                expectEquals (fixture.countVoices (anyNote, active), 0);
+            }
+        }
+
+        beginTest ("Legato slides one voice between held keys and back");
+        {
+            Fixture fixture;
+            fixture.synth.setPlayMode (SamplerSynthesiser::PlayMode::legato);
+            fixture.synth.setGlideTime (0.05);
+
+            fixture.noteOn (60);
+            fixture.noteOn (64);
+            expectEquals (fixture.countVoices (anyNote, active), 1);
+            expectEquals (fixture.countVoices (anyNote, releasing), 0);
+
+            // Back to the key still held, without retriggering
+            fixture.noteOff (64);
+            expectEquals (fixture.countVoices (anyNote, active), 1);
+            expectEquals (fixture.countVoices (anyNote, releasing), 0);
+
+            fixture.noteOff (60);
+            expectEquals (fixture.countVoices (anyNote, releasing), 1);
+        }
+
+        beginTest ("Mono retriggers, fading out the previous note");
+        {
+            Fixture fixture;
+            fixture.synth.setPlayMode (SamplerSynthesiser::PlayMode::mono);
+
+            fixture.noteOn (60);
+            fixture.noteOn (64);
+            expectEquals (fixture.countVoices (60, releasing), 1);
+            expectEquals (fixture.countVoices (64, held), 1);
+
+            fixture.render (0.02);
+            expectEquals (fixture.countVoices (anyNote, active), 1);
+        }
+    }
+
+private:
+    //==============================================================================
+    static constexpr int kick = 36, closedHat = 42, openHat = 46, anyNote = -1;
+
+    enum VoiceState { active, releasing, held };
+
+    /** Voices on a synthesiser with a drum-style set of zones: two hi-hats sharing choke
+        group 1, a kick outside any group, and a pitched zone over C4 to C5. */
+    struct Fixture
+    {
+        static constexpr int numVoices = 8;
+        static constexpr double sampleRate = 48000.0;
+
+        Fixture()
+        {
+            scratch.resize ((size_t) numVoices * SamplerVoice::scratchSize);
+
+            for (int i = 0; i < numVoices; ++i)
+                synth.addSamplerVoice (new SamplerVoice())->setScratchBuffer (scratch.data() + (size_t) i * SamplerVoice::scratchSize);
+
+            synth.setCurrentPlaybackSampleRate (sampleRate);
+
+            // Two seconds, long enough that no note ends by itself during a test
+            const auto audio = KernelCases::makeNoise (1, 96000, 3u);
+            SampleData::Ptr sample = new SampleData ("noise", sampleRate, audio,
+                                                     SampleAnalysis::analyse (audio, 96000, sampleRate));
+
+            addZone (sample, kick, kick, 0);
+            addZone (sample, closedHat, closedHat, 1);
+            addZone (sample, openHat, openHat, 1);
+            addZone (sample, 60, 72, 0);
+        }
+
+        void addZone (const SampleData::Ptr& sample, int lowNote, int highNote, int chokeGroup)
+        {
+            juce::BigInteger notes;
+            notes.setRange (lowNote, highNote - lowNote + 1, true);
+
+            auto* sound = new SamplerSound (sample, notes, lowNote);
+            sound->chokeGroup = chokeGroup;
+            synth.addSound (sound);
+        }
+
+        void noteOn (int note)   { synth.noteOn (1, note, 0.8f); }
+        void noteOff (int note)  { synth.noteOff (1, note, 0.0f, true); }
+
+        void render (double seconds)
+        {
+            juce::AudioBuffer<float> buffer (2, 512);
+            juce::MidiBuffer midi;
+
+            for (auto remaining = (int) (seconds * sampleRate); remaining > 0; remaining -= buffer.getNumSamples())
+            {
+                buffer.clear();
+                synth.renderNextBlock (buffer, midi, 0, juce::jmin (remaining, buffer.getNumSamples()));
+            }
+        }
+
+        int countVoices (int note, VoiceState state)
+        {
+            int count = 0;
+
+            for (int i = 0; i < synth.getNumVoices(); ++i)
+            {
+                auto* voice = dynamic_cast<SamplerVoice*> (synth.getVoice (i));
+
+                if (voice == nullptr || ! voice->isVoiceActive()
+                     || (note != anyNote && voice->getCurrentlyPlayingNote() != note))
+                    continue;
+
+                if (state == active
+                     || (state == releasing && voice->isReleasing())
+                     || (state == held && voice->isKeyHeld() && ! voice->isReleasing()))
+                    ++count;
+            }
+
+            return count;
+        }
+
+        std::vector<float> scratch;
+        SamplerSynthesiser synth;
+    };
+};
+
+static SynthesiserTests synthesiserTests;
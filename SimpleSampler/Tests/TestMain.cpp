@@ -0,0 +1,107 @@
+/*
+  ==============================================================================
+
+    SimpleSampler - WAV Sampler Plugin with Virtual Keyboard
+    TestMain.cpp - Test and benchmark runner
+
+    Usage: SimpleSamplerTests [--tests-only | --benchmarks-only] [--quick]
+                              [--json <file>] [--filter <text>]
+                              [--golden-dir <dir>] [--update-golden]
+
+    Runs every unit test in the SimpleSampler category, then every
+    benchmark, and exits with a non-zero status if any test failed.
+    Benchmarks never fail the run; --json writes their timings to a file.
+
+  ==============================================================================
+*/
+
+#include "Benchmarks.h"
+#include "GoldenFiles.h"
+
+#include <iostream>
+
+//==============================================================================
+static int runTests (const juce::String& filter)
+{
+    juce::Array<juce::UnitTest*> tests;
+
+    for (auto* test : juce::UnitTest::getTestsInCategory ("SimpleSampler"))
+        if (filter.isEmpty() || test->getName().containsIgnoreCase (filter))
+            tests.add (test);
+
+    juce::UnitTestRunner runner;
+    runner.setAssertOnFailure (false);
+    runner.runTests (tests);
+
+    int numFailures = 0;
+
+    for (int i = 0; i < runner.getNumResults(); ++i)
+        numFailures += runner.getResult (i)->failures;
+
+    return numFailures;
+}
+
+static void runBenchmarks (const juce::String& filter, bool quick, const juce::File& jsonFile)
+{
+    Benchmarks::Runner runner;
+    runner.setQuick (quick);
+
+    for (auto* benchmark : Benchmarks::Benchmark::getAllBenchmarks())
+    {
+        if (filter.isNotEmpty() && ! benchmark->getName().containsIgnoreCase (filter))
+            continue;
+
+        std::cout << "Benchmark " << benchmark->getName() << std::endl;
+        runner.setCurrentBenchmark (benchmark->getName());
+
+        const auto numBefore = runner.getResults().size();
+        benchmark->run (runner);
+
+        for (auto i = numBefore; i < runner.getResults().size(); ++i)
+        {
+            const auto& result = runner.getResults()[i];
+            std::cout << "  " << result.name.paddedRight (' ', 48)
+                      << juce::String (result.meanNs / 1000.0, 2).paddedLeft (' ', 10) << " us mean"
+                      << juce::String (result.maxNs / 1000.0, 2).paddedLeft (' ', 10) << " us max"
+                      << juce::String (result.nsPerItem, 2).paddedLeft (' ', 10) << " ns/item" << std::endl;
+        }
+    }
+
+    if (jsonFile != juce::File())
+    {
+        if (jsonFile.replaceWithText (runner.toJson()))
+            std::cout << "Wrote " << jsonFile.getFullPathName() << std::endl;
+        else
+            std::cerr << "Could not write " << jsonFile.getFullPathName() << std::endl;
+    }
+}
+
+//==============================================================================
+int main (int argc, char* argv[])
+{
+    // Engine benchmarks create processors, which start timers
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    const juce::ArgumentList arguments (argc, argv);
+
+    const auto filter = arguments.containsOption ("--filter") ? arguments.getValueForOption ("--filter") : juce::String();
+
+    if (arguments.containsOption ("--golden-dir"))
+        GoldenFiles::setDirectory (arguments.getFileForOption ("--golden-dir"));
+
+    GoldenFiles::setUpdating (arguments.containsOption ("--update-golden"));
+
+    int numFailures = 0;
+
+    if (! arguments.containsOption ("--benchmarks-only"))
+        numFailures = runTests (filter);
+
+    if (! arguments.containsOption ("--tests-only") && ! arguments.containsOption ("--update-golden"))
+        runBenchmarks (filter, arguments.containsOption ("--quick"),
+                       arguments.containsOption ("--json") ? arguments.getFileForOption ("--json") : juce::File());
+
+    if (numFailures > 0)
+        std::cerr << numFailures << " test failure" << (numFailures == 1 ? "" : "s") << std::endl;
+
+    return numFailures == 0 ? 0 : 1;
+}